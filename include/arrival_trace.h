@@ -0,0 +1,56 @@
+#ifndef BAKERY_ARRIVAL_TRACE_H
+#define BAKERY_ARRIVAL_TRACE_H
+
+#include <stdint.h>
+#include "common.h"
+
+// Recorded customer arrivals (ARRIVAL_TRACE in the config file).
+// With record, the customer generator appends every arrival it starts to
+// ARRIVAL_TRACE_FILE: when it was scheduled, the customer id, patience and
+// basket. With replay, the generator takes its arrivals from such a file
+// instead of generating them, so lock backends, staffing levels or code changes
+// can be compared under exactly the same load. A replayed trace is mapped with
+// mmap and read in place, record by record; pages already replayed are dropped
+// again, so traces with millions of arrivals need little memory. When the trace
+// runs out, no more customers arrive until the simulation ends.
+#define ARRIVAL_TRACE_MAGIC "BAKTRACE"
+#define ARRIVAL_TRACE_VERSION 1
+
+// Start of the file
+typedef struct {
+    char magic[8];          // ARRIVAL_TRACE_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t header_size;   // Records start here
+    uint64_t num_records;   // Written when recording ends; 0 if the recorder was killed first
+    uint64_t duration_ns;   // Offset of the last arrival
+} TraceHeader;
+
+// One arrival, followed by num_lines lines (16 bytes plus 3 per basket line)
+typedef struct __attribute__((packed)) {
+    uint64_t offset_ns;     // Scheduled arrival time, from the start of the run
+    int32_t customer_id;
+    uint16_t patience;      // Seconds
+    uint8_t order_class;
+    uint8_t num_lines;
+} TraceRecord;
+
+typedef struct __attribute__((packed)) {
+    uint8_t product_type;
+    uint8_t subtype;
+    uint8_t quantity;
+} TraceLine;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int arrival_trace_create(BakeryConfig config);
+int arrival_trace_record(const CustomerArrival *arrival, uint64_t offset_ns);
+// -1 with errno ENODATA once the trace is exhausted, EBADMSG if it is corrupt
+int arrival_trace_next(CustomerArrival *arrival, uint64_t *offset_ns);
+
+bool arrival_trace_replaying(void);
+void arrival_trace_finish(void);
+void arrival_trace_finish_on_signal(void);
+void arrival_trace_destroy(void);
+ArrivalTraceMode parse_arrival_trace_mode(const char *name);
+
+#endif // BAKERY_ARRIVAL_TRACE_H
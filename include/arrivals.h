@@ -0,0 +1,66 @@
+#ifndef BAKERY_ARRIVALS_H
+#define BAKERY_ARRIVALS_H
+
+#include "common.h"
+
+// Open-loop customer arrival schedule (CUSTOMER_ARRIVAL_PROCESS).
+// Arrival times are computed ahead on the monotonic clock and the generator
+// sleeps until each one with clock_nanosleep(TIMER_ABSTIME), so the time spent
+// starting a customer never shifts the schedule: if the generator falls
+// behind, the next customers come in at once and the lag is reported.
+//
+//   uniform  gaps uniform between CUSTOMER_ARRIVAL_MIN/MAX_INTERVAL seconds,
+//            or between 0.5 and 1.5 mean gaps when CUSTOMER_ARRIVAL_RATE is set
+//   poisson  exponential gaps with mean 1 / rate
+//   bursty   Poisson bursts of CUSTOMER_ARRIVAL_BURST_SIZE customers arriving
+//            together, at the same average rate
+//
+// The rate is CUSTOMER_ARRIVAL_RATE arrivals per second, or one customer per
+// average configured interval when it is 0. A replayed trace (see
+// arrival_trace.h) sets each arrival time itself with arrival_schedule_at.
+#define ARRIVAL_RATE_MIN 0.01
+#define ARRIVAL_RATE_MAX 10000.0
+
+// Schedule state of the generator (process-local)
+typedef struct {
+    ArrivalProcess process;
+    double rate;             // Average arrivals per second
+    double min_gap_s;        // Uniform gap range
+    double max_gap_s;
+    int burst_size;
+    int burst_left;          // Customers still to come in the current burst
+    bool replay;             // Arrival times come from arrival_schedule_at
+    uint64_t start_ns;       // CLOCK_MONOTONIC time of the first arrival
+    uint64_t next_ns;        // CLOCK_MONOTONIC time of the next arrival
+    uint64_t due_ns;         // Scheduled time of the arrival arrival_wait last returned
+} ArrivalSchedule;
+
+// Shared so management can report the achieved load in the summary
+typedef struct {
+    ArrivalProcess process;
+    bool replay;
+    double target_rate;
+    _Atomic uint64_t first_ns;
+    _Atomic uint64_t last_ns;
+    _Atomic unsigned long arrivals;
+    _Atomic unsigned long late;          // Started more than ARRIVAL_LATE_NS after their time
+    _Atomic uint64_t max_lag_ns;
+} ArrivalBoard;
+
+#define ARRIVAL_LATE_NS 1000000ULL  // 1ms
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int arrivals_create(BakeryConfig config);
+
+void arrival_schedule_init(ArrivalSchedule *schedule, BakeryConfig config);
+void arrival_schedule_at(ArrivalSchedule *schedule, uint64_t offset_ns);
+bool arrival_wait(ArrivalSchedule *schedule, const ProductionStatus *status);
+double arrivals_offered_rate(BakeryConfig config);
+unsigned long arrivals_count(void);
+void arrivals_print(void);
+void arrivals_destroy(void);
+ArrivalProcess parse_arrival_process(const char *name);
+const char *arrival_process_name(ArrivalProcess process);
+
+#endif // BAKERY_ARRIVALS_H
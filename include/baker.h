@@ -21,7 +21,7 @@ typedef struct {
 
 // Function prototypes
 void baker_process(BakerType type, int id, int inventory_shm_id, int prod_status_shm_id,
-                  int inventory_sem_id, int prod_sem_id, BakeryConfig config);
+                  BakeryConfig config);
 void initialize_baker_teams(BakerTeam *teams, BakeryConfig config);
 bool can_bake_product(BakerType baker_type, ProductType product_type);
 bool bake_products(BakerType type, ProductionStatus *status, BakeryConfig config);
@@ -21,7 +21,7 @@ typedef struct {
 
 // Function prototypes
 void chef_process(ChefType type, int id, int inventory_shm_id, int prod_status_shm_id, 
-                  int inventory_sem_id, int prod_sem_id, BakeryConfig config);
+                  BakeryConfig config);
 void initialize_chef_teams(ChefTeam *teams, BakeryConfig config);
 void reallocate_chefs(ChefTeam *teams, ChefType from_team, ChefType to_team, int count);
 bool check_dependencies(ChefType type, Inventory *inventory);
@@ -1,11 +1,22 @@
 #ifndef BAKERY_COMMON_H
 #define BAKERY_COMMON_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <time.h>
 
-// IPC keys
+#include "lock.h"
+#include "seqlock.h"
+#include "wakeup.h"
+#include "shm_region.h"
+#include "shm_arena.h"
+
+// Size of a CPU cache line, used to keep hot shared counters apart
+#define CACHE_LINE_SIZE 64
+
+// IPC keys (SHM_BACKEND=sysv only; the posix backend namespaces everything by run ID)
 #define INVENTORY_SHM_KEY 0x1234
 #define PRODUCTION_SHM_KEY 0x2345
 #define INVENTORY_SEM_KEY 0x3456
@@ -14,12 +25,26 @@
 #define MANAGEMENT_MSG_KEY 0x6789
 
 // Message types
-#define MSG_CUSTOMER_REQUEST 1
-#define MSG_MANAGEMENT_DECISION 2
-#define MSG_SUPPLY_CHAIN_UPDATE 3
+// Orders on the customer queue, by class: sellers take the lowest type first
+// (msgrcv with -MSG_SIMULATION_END), so VIP orders jump regular ones and complaints
+// wait behind both. With ORDER_PRIORITIES=0 every order uses MSG_CUSTOMER_REQUEST.
+#define MSG_VIP_REQUEST 1
+#define MSG_CUSTOMER_REQUEST 2
+#define MSG_CUSTOMER_COMPLAINT 3
 #define MSG_SIMULATION_END 4
+#define MSG_MANAGEMENT_DECISION 5
+#define MSG_SUPPLY_CHAIN_UPDATE 6
 #define MSG_CUSTOMER_RESPONSE_BASE 100  // Base for customer response IDs
 
+// Most lines a basket order can carry (CUSTOMER_MAX_PURCHASE_ITEMS is capped to this)
+#define MAX_BASKET_LINES 16
+
+// Most subtype weights one <PRODUCT>_SUBTYPE_WEIGHTS list can give
+#define MAX_SUBTYPE_WEIGHTS 16
+
+// Longest ARRIVAL_TRACE_FILE path, including the terminating NUL
+#define ARRIVAL_TRACE_PATH_LEN 64
+
 // Inventory item types (raw materials)
 typedef enum {
     ITEM_WHEAT,
@@ -63,35 +88,160 @@ typedef enum {
     BAKER_TYPE_COUNT
 } BakerType;
 
+// Roles of the simulation processes (used to group per-worker statistics)
+typedef enum {
+    ROLE_CHEF,
+    ROLE_BAKER,
+    ROLE_SELLER,
+    ROLE_SUPPLY_CHAIN,
+    ROLE_CUSTOMER,
+    ROLE_MANAGEMENT,
+    ROLE_COUNT
+} WorkerRole;
+
+// How customer orders travel to the sellers (ORDER_TRANSPORT in the config file)
+typedef enum {
+    ORDER_TRANSPORT_MSGQ,  // The SysV customer message queue
+    ORDER_TRANSPORT_RING,  // A bounded MPMC ring in shared memory (see shm_ring.h)
+    ORDER_TRANSPORT_COUNT
+} OrderTransportType;
+
+// Service classes of customer orders, most urgent first
+typedef enum {
+    ORDER_CLASS_VIP,
+    ORDER_CLASS_REGULAR,
+    ORDER_CLASS_COMPLAINT,
+    ORDER_CLASS_COUNT
+} OrderClass;
+
+// Order in which sellers serve queued orders (SELLER_SCHEDULING in the config file)
+typedef enum {
+    SCHEDULING_FIFO,  // As they come out of the order transport
+    SCHEDULING_EDF,   // Earliest customer deadline first (see order_heap.h)
+    SCHEDULING_POLICY_COUNT
+} SchedulingPolicy;
+
+// How simulated customers are run (CUSTOMER_ENGINE in the config file)
+typedef enum {
+    CUSTOMER_ENGINE_PROCESS,  // One forked process per customer
+    CUSTOMER_ENGINE_THREADS,  // State machines driven by a few threads (see customer_engine.h)
+    CUSTOMER_ENGINE_POOL,     // Pre-forked worker processes serving visit after visit (see customer_pool.h)
+    CUSTOMER_ENGINE_COUNT
+} CustomerEngineType;
+
+// Process that spaces customer arrivals (CUSTOMER_ARRIVAL_PROCESS in the config file)
+typedef enum {
+    ARRIVAL_UNIFORM,  // Uniform gaps (see arrivals.h)
+    ARRIVAL_POISSON,  // Exponential gaps
+    ARRIVAL_BURSTY,   // Poisson bursts of several customers
+    ARRIVAL_PROCESS_COUNT
+} ArrivalProcess;
+
+// Recording or replaying customer arrivals (ARRIVAL_TRACE in the config file)
+typedef enum {
+    ARRIVAL_TRACE_OFF,
+    ARRIVAL_TRACE_RECORD,  // Write every arrival to ARRIVAL_TRACE_FILE (see arrival_trace.h)
+    ARRIVAL_TRACE_REPLAY,  // Take the arrivals from ARRIVAL_TRACE_FILE instead of generating them
+    ARRIVAL_TRACE_MODE_COUNT
+} ArrivalTraceMode;
+
+// Preset for how popular products and subtypes are (PRODUCT_POPULARITY in the config file)
+typedef enum {
+    POPULARITY_UNIFORM,  // Every choice equally likely
+    POPULARITY_ZIPF,     // Skewed towards the first choices (see popularity.h)
+    POPULARITY_MODEL_COUNT
+} PopularityModel;
+
+// How sellers hand responses back to customers (RESPONSE_TRANSPORT in the config file)
+typedef enum {
+    RESPONSE_TRANSPORT_MSGQ,     // Typed messages on the customer message queue
+    RESPONSE_TRANSPORT_MAILBOX,  // One shared memory mailbox per customer (see mailbox.h)
+    RESPONSE_TRANSPORT_COUNT
+} ResponseTransportType;
+
+// What a process does while a shared memory queue is empty or full
+typedef enum {
+    WAIT_SPIN,   // Busy-poll with a CPU pause, lowest latency
+    WAIT_YIELD,  // Poll but give the CPU away between attempts
+    WAIT_FUTEX,  // Sleep in the kernel until notified
+    WAIT_STRATEGY_COUNT
+} WaitStrategy;
+
 // Shared memory structure for inventory
+// One lock per raw material, so chefs with disjoint recipes do not serialize.
+// Changes are published through the writers' sequence locks (see stats.h)
 typedef struct {
-    int quantities[ITEM_RAW_MATERIAL_COUNT];
+    BakeryLock item_locks[ITEM_RAW_MATERIAL_COUNT];  // item_locks[i] protects quantities[i]
+    _Atomic int quantities[ITEM_RAW_MATERIAL_COUNT];
     int min_thresholds[ITEM_RAW_MATERIAL_COUNT];
+    WakeupChannel restocked[ITEM_RAW_MATERIAL_COUNT];  // Notified by the supply chain after a restock
 } Inventory;
 
+// Intermediate goods that are produced by one team and consumed by another
+typedef enum {
+    WIP_PASTE,   // Paste chefs -> patisserie chefs
+    WIP_BREAD,   // Bread bakers -> sandwich chefs (and customers)
+    WIP_ITEM_COUNT
+} WipItem;
+
+// Work-in-progress ledger entry, one cache line per item
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic int available;  // On hand and not reserved
+    _Atomic int reserved;   // Claimed by a consumer that has not committed yet
+    _Atomic int consumed;   // Committed consumption
+    WakeupChannel ready;    // Notified whenever units become available
+} WipEntry;
+
+// Work-in-progress ledger for intermediate goods, updated lock-free (see wip_ledger.h)
+typedef struct {
+    WipEntry entries[WIP_ITEM_COUNT];
+} WipLedger;
+
 // Shared memory structure for production status
+// Counters are atomic so single-field updates never need the production semaphore.
+// Customer and profit statistics live in per-worker shards (see stats.h), and
+// so do the sequence locks that give readers consistent snapshots of the counters.
 typedef struct {
-    int produced_items[PRODUCT_TYPE_COUNT];
-    int sold_items[PRODUCT_TYPE_COUNT];
-    int frustrated_customers;
-    int complained_customers;
-    int missing_items_requests;
-    double total_profit;
+    BakeryLock lock;  // Needed only for updates spanning several fields
+    _Atomic int produced_items[PRODUCT_TYPE_COUNT];
+    _Atomic int sold_items[PRODUCT_TYPE_COUNT];
+    WipLedger wip;    // Stock of paste and bread available to the chefs
+    ShmOffset subtype_sold[PRODUCT_TYPE_COUNT];  // Arena arrays of num_categories[type] counters
     time_t start_time;
     bool simulation_active;
 } ProductionStatus;
 
-// Message structure for customer requests
+// One line of a basket order
 typedef struct {
-    long msg_type;
-    int customer_id;
     ProductType product_type;
     int subtype;  // Flavor, variety, etc.
     int quantity;
-    bool is_complaint;
-    bool fulfilled;  // Indicates if request was fulfilled
+    bool fulfilled;  // Set by the seller in the response
+} BasketLine;
+
+// Message structure for customer requests: the whole basket of one visit,
+// answered with one response carrying the result of every line
+typedef struct {
+    long msg_type;
+    int customer_id;
+    int num_lines;
+    BasketLine lines[MAX_BASKET_LINES];
+    OrderClass order_class;     // A complaint is about lines[0]
+    uint64_t request_id;        // Unique per order, echoed in the response
+    uint64_t deadline_ns;       // CLOCK_MONOTONIC time the customer gives up, 0 for none
+    uint64_t enqueued_ns;       // CLOCK_MONOTONIC send time, stamped by order_send
+    bool fulfilled;     // Every line was fulfilled
+    int reply_slot;             // Customer's response mailbox, -1 to answer on the message queue
+    unsigned int reply_seq;     // Sequence the mailbox expects for this request
 } CustomerMsg;
 
+// A customer as the generator decides it, handed as a whole to whatever runs the visit
+typedef struct {
+    int customer_id;
+    int patience;         // Seconds the customer waits for the basket
+    CustomerMsg request;  // Basket order, without reply slot, request ID or deadline yet
+} CustomerArrival;
+
 // Message structure for management decisions
 typedef struct {
     long msg_type;
@@ -131,7 +281,48 @@ typedef struct {
     // Customer parameters
     int customer_params[4];  // [arrival_min, arrival_max, patience_min, patience_max]
     double complaint_probability;
+    double vip_probability;      // Chance that a customer is served as VIP
     int max_purchase_items;
+    CustomerEngineType customer_engine;
+    int customer_engine_threads;  // Worker threads of the threaded engine
+    int customer_pool_size;       // Worker processes of the customer pool
+    ArrivalProcess arrival_process;
+    double arrival_rate;          // Arrivals per second (0 = one per average arrival interval)
+    int arrival_burst_size;       // Customers per burst with the bursty process
+    
+    // Product popularity
+    PopularityModel product_popularity;
+    PopularityModel subtype_popularity;
+    double zipf_exponent;         // Skew of the zipf presets
+    double product_weights[PRODUCT_TYPE_COUNT];  // PRODUCT_WEIGHTS, overrides the preset when given
+    int num_product_weights;
+    double subtype_weights[PRODUCT_TYPE_COUNT][MAX_SUBTYPE_WEIGHTS];  // <PRODUCT>_SUBTYPE_WEIGHTS
+    int num_subtype_weights[PRODUCT_TYPE_COUNT];
+    ArrivalTraceMode arrival_trace;
+    char arrival_trace_file[ARRIVAL_TRACE_PATH_LEN];
+    
+    // Synchronization options
+    bool atomic_counters;  // Update single counters lock-free instead of under prod_sem
+    LockBackend lock_backend;  // Implementation of the inventory/production locks
+    bool event_wakeups;    // Chefs block until a restock/deposit instead of sleeping a fixed time
+    bool lock_stats;       // Record per-lock, per-role wait/hold histograms (see lockstat.h)
+    
+    // Shared memory options
+    ShmOptions shm;        // Backend, run ID, huge pages and prefaulting (see shm_region.h)
+    
+    // Order transport options
+    OrderTransportType order_transport;
+    int order_ring_slots;        // Ring capacity, rounded up to a power of two
+    WaitStrategy order_ring_wait;
+    ResponseTransportType response_transport;
+    int mailbox_slots;           // Mailboxes shared by concurrent customers, rounded up to a power of two (0 = estimate)
+    bool order_priorities;       // Serve orders by class instead of strictly FIFO
+    int msgq_inflight_orders;    // Orders the customer queue must hold at once (0 = estimate from the load)
+    
+    // Seller options
+    int seller_batch_size;       // Orders a seller serves per production lock hold (1 = one at a time)
+    SchedulingPolicy seller_scheduling;
+    int order_heap_slots;        // Orders the EDF heap can hold
 } BakeryConfig;
 
 // Forward declaration for config loading function
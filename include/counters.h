@@ -0,0 +1,49 @@
+#ifndef BAKERY_COUNTERS_H
+#define BAKERY_COUNTERS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Lock-free helpers for the counters in ProductionStatus.
+// Single-counter updates go through these instead of a semaphore round-trip;
+// the production semaphore is only needed when several fields must change together.
+
+// Add delta to a shared counter
+static inline void counter_add(_Atomic int *counter, int delta) {
+    atomic_fetch_add_explicit(counter, delta, memory_order_relaxed);
+}
+
+// Read the current value of a shared counter
+static inline int counter_read(_Atomic int *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+// Increment a counter only if it stays below limit, stores the new value in *new_value
+static inline bool counter_increment_below(_Atomic int *counter, int limit, int *new_value) {
+    int current = atomic_load_explicit(counter, memory_order_relaxed);
+
+    while (current < limit) {
+        if (atomic_compare_exchange_weak_explicit(counter, &current, current + 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            if (new_value) {
+                *new_value = current + 1;
+            }
+            return true;
+        }
+        // current was reloaded by the failed exchange, try again
+    }
+
+    return false;
+}
+
+// Add an amount to the shared profit total
+static inline void profit_add(_Atomic double *profit, double amount) {
+    double current = atomic_load_explicit(profit, memory_order_relaxed);
+
+    while (!atomic_compare_exchange_weak_explicit(profit, &current, current + amount,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+        // current was reloaded by the failed exchange, try again
+    }
+}
+
+#endif // BAKERY_COUNTERS_H
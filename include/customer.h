@@ -14,12 +14,18 @@ typedef struct {
 } Customer;
 
 // Function prototypes
-void customer_process(int id, int customer_msgq_id, int prod_status_shm_id, 
-                     int prod_sem_id, BakeryConfig config);
+void customer_process(const CustomerArrival *arrival, int customer_msgq_id,
+                      int prod_status_shm_id, BakeryConfig config);
+void customer_worker_process(int index, int customer_msgq_id, int prod_status_shm_id,
+                             BakeryConfig config);
 void generate_customer_request(CustomerMsg *msg, int customer_id, BakeryConfig config);
+void generate_customer_arrival(CustomerArrival *arrival, int customer_id, BakeryConfig config);
+int check_customer_response(const CustomerMsg *response);
+bool prepare_complaint(CustomerMsg *request, int unfulfilled_line, BakeryConfig config);
+void finish_customer_visit(CustomerMsg *request, int unfulfilled_line, BakeryConfig config);
 void handle_timeout(int sig);
 void simulate_customer_behavior(int customer_msgq_id, BakeryConfig config, int customer_id);
 void customer_generator(int customer_msgq_id, int prod_status_shm_id, 
-                       int prod_sem_id, BakeryConfig config);
+                       BakeryConfig config);
 
 #endif // BAKERY_CUSTOMER_H
\ No newline at end of file
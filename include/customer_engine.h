@@ -0,0 +1,49 @@
+#ifndef BAKERY_CUSTOMER_ENGINE_H
+#define BAKERY_CUSTOMER_ENGINE_H
+
+#include "common.h"
+
+// Threaded customer engine (CUSTOMER_ENGINE=threads).
+// Instead of forking a process per customer, the customer generator runs a few
+// worker threads that each drive many customers as small state machines:
+// a customer arrives, sends its basket, waits until its response or its
+// deadline, then leaves (maybe complaining). Waiting costs no thread: each
+// worker keeps its customers' deadlines in a timer heap and sleeps on the
+// ready channel of its mailbox group (see mailbox.h) until the next deadline
+// or the next response. Orders reach the sellers through the same order transport
+// as from customer processes, so the engine needs RESPONSE_TRANSPORT=mailbox.
+// Workers never block on a full order channel or on a full mailbox table:
+// refused orders, complaints and customers waiting for a mailbox are kept on a
+// per-worker list and retried on every pass.
+
+// Counters of one worker thread, written only by that thread
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long admitted;
+    _Atomic unsigned long served;       // Left with a response
+    _Atomic unsigned long timed_out;    // Left when patience ran out
+    _Atomic unsigned long turned_away;  // Left before a mailbox freed up (not a customer outcome)
+    _Atomic int waiting;                // Customers waiting for a response right now
+    _Atomic int max_waiting;
+    _Atomic unsigned long deferred;     // Orders and complaints retried because the channel was full
+} CustomerEngineWorker;
+
+// Shared so management can report the engine in the summary
+typedef struct {
+    int num_workers;
+    CustomerEngineWorker workers[];
+} CustomerEngineBoard;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int customer_engine_create(BakeryConfig config);
+int customer_engine_start(BakeryConfig config);
+int customer_engine_admit(const CustomerArrival *arrival);
+
+bool customer_engine_enabled(void);
+void customer_engine_stop(void);
+void customer_engine_print(void);
+void customer_engine_destroy(void);
+CustomerEngineType parse_customer_engine(const char *name);
+const char *customer_engine_name(CustomerEngineType type);
+
+#endif // BAKERY_CUSTOMER_ENGINE_H
@@ -0,0 +1,46 @@
+#ifndef BAKERY_CUSTOMER_POOL_H
+#define BAKERY_CUSTOMER_POOL_H
+
+#include "common.h"
+#include "shm_ring.h"
+
+// Pre-forked customer worker pool (CUSTOMER_ENGINE=pool).
+// The customer generator forks CUSTOMER_POOL_SIZE long-lived worker processes
+// once and then only pushes arrivals on a shared ring; each worker takes the
+// next arrival and runs the same visit a customer process would, over and over.
+// Customers keep their own process, but no fork is paid per arrival, and the
+// generator reaps the workers when the simulation ends. Idle workers, and a
+// generator waiting for room in the ring, wake up every CUSTOMER_POOL_POLL_MS
+// to notice the end of the simulation.
+#define CUSTOMER_POOL_POLL_MS 1000
+
+// Session counters of one worker, written only by that worker
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic int pid;
+    _Atomic unsigned long sessions;
+    _Atomic unsigned long long busy_ns;  // Time spent in visits
+} CustomerPoolWorker;
+
+typedef struct {
+    int num_workers;
+    _Atomic uint64_t started_ns;     // When the workers were started
+    _Atomic unsigned long submitted;
+    _Atomic unsigned long backlog_stalls;  // Arrivals that found every queue slot taken
+    CustomerPoolWorker workers[];
+} CustomerPoolBoard;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int customer_pool_create(BakeryConfig config);
+int customer_pool_submit(const CustomerArrival *arrival, const ProductionStatus *status);
+int customer_pool_take(CustomerArrival *arrival);
+
+bool customer_pool_enabled(void);
+int customer_pool_size(void);
+void customer_pool_started(void);
+void customer_pool_bind_worker(int index);
+void customer_pool_record_session(uint64_t busy_ns);
+void customer_pool_print(void);
+void customer_pool_destroy(void);
+
+#endif // BAKERY_CUSTOMER_POOL_H
@@ -0,0 +1,48 @@
+#ifndef BAKERY_HISTOGRAM_H
+#define BAKERY_HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+// Log2 latency histograms kept in shared memory.
+// Bucket 0 counts times below 1us, bucket k counts [2^(k-1), 2^k) us,
+// and the last bucket collects everything longer
+#define HISTOGRAM_BUCKETS 24
+
+// Monotonic clock in nanoseconds
+static inline uint64_t histogram_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Histogram bucket of a duration
+static inline int histogram_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+
+    if (us == 0) {
+        return 0;
+    }
+
+    int bucket = 64 - __builtin_clzll(us);
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// Upper bound in microseconds of the bucket holding the given percentile
+static inline unsigned long histogram_percentile_us(_Atomic unsigned long *hist,
+                                                    unsigned long total, int percent) {
+    unsigned long target = (total * percent + 99) / 100;
+    unsigned long seen = 0;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hist[i], memory_order_relaxed);
+        if (seen >= target) {
+            return 1UL << i;
+        }
+    }
+
+    return 1UL << (HISTOGRAM_BUCKETS - 1);
+}
+
+#endif // BAKERY_HISTOGRAM_H
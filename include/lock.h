@@ -0,0 +1,59 @@
+#ifndef BAKERY_LOCK_H
+#define BAKERY_LOCK_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Largest number of locks that can be taken together with bakery_lock_try_acquire_set
+#define LOCK_SET_MAX 16
+
+// Lock backends, chosen at startup with LOCK_BACKEND in the config file
+typedef enum {
+    LOCK_BACKEND_SYSV,    // System V semaphore, every acquire/release is a semop syscall
+    LOCK_BACKEND_MUTEX,   // Robust PTHREAD_PROCESS_SHARED mutex, futex based
+    LOCK_BACKEND_TICKET,  // Fair ticket spinlock with proportional backoff
+    LOCK_BACKEND_COUNT
+} LockBackend;
+
+// A lock that lives in shared memory next to the data it protects.
+// Only the fields of the selected backend are used.
+typedef struct {
+    LockBackend backend;
+    int stat_id;  // Row in the lock statistics table, -1 if not tracked
+
+    // LOCK_BACKEND_SYSV
+    int sem_id;
+    int sem_num;
+
+    // LOCK_BACKEND_MUTEX
+    pthread_mutex_t mutex;
+
+    // LOCK_BACKEND_TICKET
+    _Atomic unsigned int next_ticket;
+    _Atomic unsigned int now_serving;
+} BakeryLock;
+
+// Tell the CPU we are busy-waiting
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#else
+    atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+// Function prototypes
+// All functions return 0 on success and -1 with errno set on failure, like semop()
+int bakery_lock_init(BakeryLock *lock, LockBackend backend, int sem_id, int sem_num);
+int bakery_lock_acquire(BakeryLock *lock);
+int bakery_lock_try_acquire(BakeryLock *lock);
+int bakery_lock_release(BakeryLock *lock);
+int bakery_lock_try_acquire_set(BakeryLock *locks, const int *indices, int count);
+int bakery_lock_release_set(BakeryLock *locks, const int *indices, int count);
+void bakery_lock_destroy(BakeryLock *lock);
+LockBackend parse_lock_backend(const char *name);
+const char *lock_backend_name(LockBackend backend);
+
+#endif // BAKERY_LOCK_H
@@ -0,0 +1,44 @@
+#ifndef BAKERY_LOCKSTAT_H
+#define BAKERY_LOCKSTAT_H
+
+#include <stdint.h>
+#include "common.h"
+#include "histogram.h"
+
+// Locks that can be tracked and the length of their names
+#define LOCKSTAT_MAX_LOCKS 16
+#define LOCKSTAT_NAME_LEN 32
+
+// Wait and hold times use log2 histograms (see histogram.h)
+#define LOCKSTAT_BUCKETS HISTOGRAM_BUCKETS
+
+// Counters of one lock as seen by one role, on their own cache line(s)
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long acquires;
+    _Atomic unsigned long busy;           // Failed try-acquires
+    _Atomic unsigned long long wait_ns;   // Total time spent acquiring
+    _Atomic unsigned long long hold_ns;   // Total time between acquire and release
+    _Atomic unsigned long wait_hist[LOCKSTAT_BUCKETS];
+    _Atomic unsigned long hold_hist[LOCKSTAT_BUCKETS];
+} LockStatCell;
+
+// Shared memory table with one row per tracked lock and one cell per role
+typedef struct {
+    _Atomic int num_locks;
+    char names[LOCKSTAT_MAX_LOCKS][LOCKSTAT_NAME_LEN];
+    LockStatCell cells[LOCKSTAT_MAX_LOCKS][ROLE_COUNT];
+} LockStatTable;
+
+// Function prototypes
+// Instrumentation is off (and costs one branch) until lockstat_create succeeds
+int lockstat_create(void);
+void lockstat_track(BakeryLock *lock, const char *name);
+void lockstat_bind_role(WorkerRole role);
+uint64_t lockstat_begin(void);
+void lockstat_acquired(int stat_id, uint64_t start);
+void lockstat_busy(int stat_id);
+void lockstat_released(int stat_id);
+void lockstat_print(void);
+void lockstat_destroy(int lockstat_shm_id);
+
+#endif // BAKERY_LOCKSTAT_H
@@ -0,0 +1,65 @@
+#ifndef BAKERY_MAILBOX_H
+#define BAKERY_MAILBOX_H
+
+#include "common.h"
+
+// Per-customer response mailboxes in shared memory (RESPONSE_TRANSPORT=mailbox).
+// A customer claims a slot on arrival (hashed by its id, linear probing on
+// collisions) and names it in every request together with a fresh sequence
+// number. The seller writes the response straight into that slot and wakes the
+// customer through the slot's futex, so delivery costs the same however many
+// customers or messages are pending. A response whose customer already gave up
+// (the sequence no longer matches) is dropped instead of clogging a queue.
+//
+// A thread serving many customers at once (see customer_engine.h) cannot block
+// on each slot's futex. It claims its slots in a group instead: every delivery
+// to such a slot is also pushed on the group's ready list and wakes the group's
+// channel, so the thread learns which of its customers got a response.
+#define MAILBOX_GROUPS 64
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic int owner;  // Customer id + 1, 0 while free
+    _Atomic unsigned int next_seq;     // Source of request sequence numbers for this slot
+    _Atomic unsigned int wanted;       // Sequence the owner waits for (0 = none, high bit = being written)
+    _Atomic unsigned int delivered;    // Sequence of the response held in the slot
+    WakeupChannel ready;
+    _Atomic int group;                 // Group + 1, 0 if the owner waits on ready
+    _Atomic int next_ready;            // Next slot + 1 on the group's ready list
+    CustomerMsg response;
+} Mailbox;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic int head;  // First slot + 1 on the ready list, 0 if empty
+    WakeupChannel ready;                          // Notified after every push
+} MailboxGroup;
+
+typedef struct {
+    uint32_t num_slots;  // Power of two
+    uint32_t mask;
+    _Atomic long delivered_count;
+    _Atomic long dropped_count;
+    MailboxGroup groups[MAILBOX_GROUPS];
+    Mailbox slots[];
+} MailboxTable;
+
+// Function prototypes
+int mailbox_create(BakeryConfig config);
+bool mailbox_enabled(void);
+int mailbox_num_slots(void);
+int mailbox_claim(int customer_id);
+int mailbox_claim_in_group(int customer_id, int group);
+unsigned int mailbox_expect(int slot);
+bool mailbox_deliver(int slot, unsigned int seq, const CustomerMsg *response);
+int mailbox_wait(int slot, unsigned int seq, CustomerMsg *response, const struct timespec *deadline);
+int mailbox_take(int slot, unsigned int seq, CustomerMsg *response);
+bool mailbox_cancel(int slot, unsigned int seq);
+void mailbox_release(int slot);
+WakeupChannel *mailbox_group_channel(int group);
+int mailbox_group_take(int group);
+int mailbox_group_next(int slot);
+void mailbox_print(void);
+void mailbox_destroy(void);
+ResponseTransportType parse_response_transport(const char *name);
+const char *response_transport_name(ResponseTransportType type);
+
+#endif // BAKERY_MAILBOX_H
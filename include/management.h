@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "chef.h"
+#include "snapshot.h"
 
 // Management data structure
 typedef struct {
@@ -13,10 +14,10 @@ typedef struct {
 // Function prototypes
 void management_process(int inventory_shm_id, int prod_status_shm_id, 
                       int management_msgq_id, int customer_msgq_id,
-                      int inventory_sem_id, int prod_sem_id, BakeryConfig config);
-void analyze_production_needs(ProductionStatus *status, ChefTeam *teams, ManagementMsg *msg);
-void check_end_conditions(ProductionStatus *status, BakeryConfig config, bool *should_end);
+                      BakeryConfig config);
+void analyze_production_needs(ProductionSnapshot *status, ChefTeam *teams, ManagementMsg *msg);
+void check_end_conditions(ProductionSnapshot *status, BakeryConfig config, bool *should_end);
 void reassign_chefs(ChefTeam *teams, ManagementMsg *decision);
-void notify_all_processes(int customer_msgq_id, int management_msgq_id);
+void notify_all_processes(int customer_msgq_id, int management_msgq_id, int num_sellers);
 
 #endif // BAKERY_MANAGEMENT_H
\ No newline at end of file
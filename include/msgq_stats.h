@@ -0,0 +1,29 @@
+#ifndef BAKERY_MSGQ_STATS_H
+#define BAKERY_MSGQ_STATS_H
+
+#include "common.h"
+
+// Capacity telemetry for a SysV message queue.
+// msgsnd() blocks silently once a queue holds msg_qbytes bytes, so the parent
+// raises the limit at startup to fit the configured load, and management
+// samples depth and bytes with IPC_STAT to show how close the queue came.
+
+// Samples taken by one process (management keeps these locally)
+typedef struct {
+    unsigned long samples;
+    unsigned long full_samples;    // Samples with less than one order of room left
+    unsigned long long depth_sum;  // For the average depth
+    unsigned long max_depth;       // High-watermark in messages
+    unsigned long max_bytes;       // High-watermark in bytes
+    unsigned long limit_bytes;     // msg_qbytes at the last sample
+} MsgqStats;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int msgq_raise_limit(int msgq_id, unsigned long wanted_bytes);
+int msgq_sample(int msgq_id, MsgqStats *stats);
+
+int msgq_inflight_orders(BakeryConfig config);
+void msgq_print(const char *label, const MsgqStats *stats);
+
+#endif // BAKERY_MSGQ_STATS_H
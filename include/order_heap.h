@@ -0,0 +1,63 @@
+#ifndef BAKERY_ORDER_HEAP_H
+#define BAKERY_ORDER_HEAP_H
+
+#include "common.h"
+#include "wakeup.h"
+
+// Shared earliest-deadline-first queue of orders (SELLER_SCHEDULING=edf).
+// Sellers move every order waiting in the transport into this binary min-heap
+// and always serve the one whose customer runs out of patience first. With
+// ORDER_PRIORITIES=1 the class is compared before the deadline; orders without
+// a deadline (complaints) sort last. End messages never enter the heap. The heap
+// lives in shared memory and is protected by a BakeryLock of the configured backend.
+//
+// Orders stay in fixed slots; the heap itself is an array of slot numbers placed
+// after the slots, and a list through the slots in arrival order gives the order
+// FIFO would serve next without a scan. While the heap is empty, one idle seller
+// blocks on the transport for everyone (the receiver) and the others sleep on
+// the pushed channel, which every push and every change of receiver notifies.
+typedef struct {
+    uint64_t arrival;  // Order in which entries were pushed, to spot reordering
+    int older;         // Neighbours in arrival order (-1 at either end)
+    int newer;         // Also links free slots
+    CustomerMsg order;
+} OrderHeapEntry;
+
+typedef struct {
+    BakeryLock lock;
+    WakeupChannel pushed;     // Notified by pushes and receiver changes
+    _Atomic int receiver;     // 1 while an idle seller waits on the transport for everyone
+    bool by_class;            // Compare order classes before deadlines
+    int capacity;
+    int size;
+    int max_size;
+    uint64_t next_arrival;
+    int oldest;               // Slot of the oldest entry, what FIFO would pop next (-1 if empty)
+    int newest;
+    int free_head;            // First free slot (-1 if full)
+    unsigned long dispatches;
+    unsigned long reordered;  // Dispatches that overtook an older order
+    OrderHeapEntry entries[]; // capacity slots, then capacity heap positions (int)
+} OrderHeap;
+
+// Longest an idle seller sleeps on the pushed channel before checking the transport itself
+#define ORDER_HEAP_IDLE_WAIT_MS 100
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int order_heap_create(BakeryConfig config);
+bool order_heap_enabled(void);
+int order_heap_push(const CustomerMsg *order);
+int order_heap_pop(CustomerMsg *order);
+bool order_heap_full(void);
+bool order_heap_empty(void);
+bool order_heap_claim_receiver(void);
+void order_heap_release_receiver(void);
+unsigned int order_heap_prepare_wait(void);
+int order_heap_wait(unsigned int seen);
+void order_heap_print(void);
+void order_heap_destroy(void);
+SchedulingPolicy parse_scheduling_policy(const char *name);
+const char *scheduling_policy_name(SchedulingPolicy policy);
+
+#endif // BAKERY_ORDER_HEAP_H
@@ -0,0 +1,48 @@
+#ifndef BAKERY_ORDER_TRANSPORT_H
+#define BAKERY_ORDER_TRANSPORT_H
+
+#include "common.h"
+#include "histogram.h"
+
+// Customer -> seller order channel (requests, complaints and the end-of-simulation
+// message), chosen with ORDER_TRANSPORT. Responses travel separately, on the
+// customer message queue or through mailboxes (see mailbox.h). The parent
+// creates the transport before forking, so every process inherits it.
+//
+// With ORDER_PRIORITIES=1 sellers always take the most urgent class first: on the
+// message queue each class has its own message type, on the ring transport each
+// class has its own ring. End messages queue behind every class.
+
+// Queue statistics of one order class, on their own cache line(s)
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long sent;
+    _Atomic unsigned long received;
+    _Atomic int depth;                    // Orders sent but not received yet
+    _Atomic int max_depth;
+    _Atomic unsigned long stalls;         // Sends that found the channel full and had to wait
+    _Atomic unsigned long long wait_ns;   // Total time orders spent queued
+    _Atomic unsigned long wait_hist[HISTOGRAM_BUCKETS];
+} OrderClassStats;
+
+// Shared state of the transport
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) WakeupChannel pending;  // Notified after a push when each class has a ring
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t next_request_id;
+    OrderClassStats classes[ORDER_CLASS_COUNT];
+} OrderBoard;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int order_transport_create(BakeryConfig config, int customer_msgq_id);
+int order_send(const CustomerMsg *msg);
+int order_try_send(const CustomerMsg *msg);
+int order_receive(CustomerMsg *msg);
+int order_try_receive(CustomerMsg *msg);
+uint64_t order_new_request_id(void);
+bool order_expired(const CustomerMsg *msg);
+void order_transport_print(void);
+void order_transport_destroy(void);
+OrderTransportType parse_order_transport(const char *name);
+const char *order_transport_name(OrderTransportType type);
+
+#endif // BAKERY_ORDER_TRANSPORT_H
@@ -0,0 +1,42 @@
+#ifndef BAKERY_ORDER_WIRE_H
+#define BAKERY_ORDER_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "common.h"
+
+// Compact encoding of CustomerMsg for the SysV customer queue.
+// CustomerMsg is laid out for convenient use in memory (int enums, padded bools,
+// MAX_BASKET_LINES lines whatever the basket size); on the queue an order is
+// packed without padding and carries only the lines it uses, so more orders fit
+// under the queue's msg_qbytes limit.
+typedef struct __attribute__((packed)) {
+    uint8_t product_type;
+    uint8_t subtype;
+    uint8_t quantity;
+    uint8_t fulfilled;
+} WireLine;
+
+typedef struct __attribute__((packed)) {
+    long msg_type;  // Must come first for msgsnd/msgrcv
+    int32_t customer_id;
+    uint64_t request_id;
+    uint64_t deadline_ns;
+    uint64_t enqueued_ns;
+    int32_t reply_slot;
+    uint32_t reply_seq;
+    uint8_t order_class;
+    uint8_t fulfilled;
+    uint8_t num_lines;
+    WireLine lines[MAX_BASKET_LINES];
+} OrderWire;
+
+// Largest message on the queue, payload only (without msg_type)
+#define ORDER_WIRE_MAX_PAYLOAD (sizeof(OrderWire) - sizeof(long))
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure, like msgsnd()/msgrcv()
+int order_wire_send(int msgq_id, const CustomerMsg *msg, int flags);
+int order_wire_receive(int msgq_id, CustomerMsg *msg, long msg_type, int flags);
+
+#endif // BAKERY_ORDER_WIRE_H
@@ -0,0 +1,37 @@
+#ifndef BAKERY_POPULARITY_H
+#define BAKERY_POPULARITY_H
+
+#include "common.h"
+
+// Product and subtype popularity of customer baskets.
+// PRODUCT_POPULARITY and SUBTYPE_POPULARITY pick a preset:
+//
+//   uniform  every choice equally likely
+//   zipf     the k-th choice weighs 1 / k^ZIPF_EXPONENT, so bread is the most
+//            popular product and subtype 0 the most popular subtype
+//
+// An explicit PRODUCT_WEIGHTS list (bread, sandwich, cake, sweet, sweet
+// patisserie, savory patisserie) or <PRODUCT>_SUBTYPE_WEIGHTS list overrides
+// the preset; unlisted choices weigh 0. Paste is an intermediate and is never
+// bought. Walker alias tables are built once by the parent before forking, so
+// every line of a basket costs two random numbers whatever the skew.
+
+// Alias table over size choices
+typedef struct {
+    int size;
+    double *keep;  // Chance of keeping the column that was drawn
+    int *alias;    // Choice taken otherwise
+} AliasTable;
+
+// Function prototypes
+// Return 0 on success and -1 with errno set on failure
+int popularity_create(BakeryConfig config);
+
+ProductType popularity_pick_product(void);
+int popularity_pick_subtype(ProductType type);
+void popularity_destroy(void);
+PopularityModel parse_popularity_model(const char *name);
+const char *popularity_model_name(PopularityModel model);
+int parse_popularity_weights(const char *value, double *weights, int max_weights);
+
+#endif // BAKERY_POPULARITY_H
@@ -13,7 +13,7 @@ typedef struct {
 
 // Function prototypes
 void seller_process(int id, int customer_msgq_id, int prod_status_shm_id, 
-                    int prod_sem_id, BakeryConfig config);
+                    BakeryConfig config);
 void handle_customer_request(CustomerMsg *request, ProductionStatus *status, 
                            BakeryConfig config, int *customers_served);
 void handle_customer_complaint(CustomerMsg *complaint, ProductionStatus *status);
@@ -0,0 +1,69 @@
+#ifndef BAKERY_SEQLOCK_H
+#define BAKERY_SEQLOCK_H
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "lock.h"
+
+// Polls of a busy sequence before yielding the CPU to the writer
+#define SEQLOCK_SPINS_BEFORE_YIELD 100
+
+// Yields after which a sequence that stays odd is taken to belong to a writer
+// that died inside its write section
+#define SEQLOCK_STALE_YIELDS 1000
+
+// Sequence lock for publishing consistent snapshots of shared memory.
+// The sequence is odd while its writer is inside a write section. Each sequence
+// has exactly one writer, so entering a section is a plain store and writers
+// never wait for each other; shared data gets one sequence per writer (see
+// stats.h) and readers check all of them. Readers take no lock: they copy the
+// data and retry if a sequence moved.
+typedef struct {
+    _Atomic unsigned int sequence;
+} SeqLock;
+
+// Enter a write section (only the owner of the sequence may call this)
+static inline void seqlock_write_begin(SeqLock *lock) {
+    unsigned int seq = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+    atomic_store_explicit(&lock->sequence, seq + 1, memory_order_relaxed);
+
+    // Readers that see any of our stores also see the odd sequence
+    atomic_thread_fence(memory_order_release);
+}
+
+// Leave a write section, publishing the stores made inside it
+static inline void seqlock_write_end(SeqLock *lock) {
+    unsigned int seq = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+    atomic_store_explicit(&lock->sequence, seq + 1, memory_order_release);
+}
+
+// Start a read, waiting out a writer in progress; returns the sequence to validate against.
+// A sequence still odd after SEQLOCK_STALE_YIELDS is returned as it is, so a writer
+// killed inside its section cannot stall readers forever
+static inline unsigned int seqlock_read_begin(SeqLock *lock) {
+    unsigned int seq;
+    int spins = 0;
+    int yields = 0;
+
+    while (((seq = atomic_load_explicit(&lock->sequence, memory_order_acquire)) & 1) &&
+           yields < SEQLOCK_STALE_YIELDS) {
+        cpu_relax();
+        if (++spins >= SEQLOCK_SPINS_BEFORE_YIELD) {
+            sched_yield();
+            spins = 0;
+            yields++;
+        }
+    }
+
+    return seq;
+}
+
+// Finish a read; true if a writer got in the way and the copy must be taken again
+static inline bool seqlock_read_retry(SeqLock *lock, unsigned int start) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&lock->sequence, memory_order_relaxed) != start;
+}
+
+#endif // BAKERY_SEQLOCK_H
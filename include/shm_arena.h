@@ -0,0 +1,49 @@
+#ifndef BAKERY_SHM_ARENA_H
+#define BAKERY_SHM_ARENA_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Offset of a block from the start of the arena. Unlike a pointer it means the
+// same thing in every process, whatever address the segment is mapped at.
+typedef uint64_t ShmOffset;
+#define SHM_NULL ((ShmOffset) 0)
+
+// Size classes hold 16, 32, ... 32768 byte payloads; larger requests are rejected
+#define SHM_ARENA_CLASSES 12
+#define SHM_ARENA_MIN_BLOCK 16
+#define SHM_ARENA_MAX_BLOCK (SHM_ARENA_MIN_BLOCK << (SHM_ARENA_CLASSES - 1))
+
+// Arena header at the start of its shared memory region. Blocks are carved from
+// the region with an atomic bump pointer and recycled through one lock-free
+// (Treiber) free list per size class. List heads carry a tag in their upper
+// bits that changes on every update, so a CAS cannot succeed on a stale head (ABA).
+typedef struct {
+    uint64_t size;                                  // Bytes in the region, header included
+    uint64_t data_start;                            // Offset of the first block
+    _Atomic uint64_t bump;                          // Offset of the next never-used byte
+    _Atomic uint64_t free_lists[SHM_ARENA_CLASSES]; // Tagged offsets of the first free block
+    _Atomic long live_blocks[SHM_ARENA_CLASSES];
+} ShmArena;
+
+// Function prototypes
+int shm_arena_create(size_t size);
+ShmArena *shm_arena_attach(int handle);
+ShmArena *shm_arena_local(void);
+ShmOffset shm_arena_alloc(ShmArena *arena, size_t size);
+ShmOffset shm_arena_calloc(ShmArena *arena, size_t count, size_t size);
+void shm_arena_free(ShmArena *arena, ShmOffset offset);
+void shm_arena_print(ShmArena *arena);
+
+// Resolve an offset in this process's mapping (NULL for SHM_NULL)
+static inline void *shm_arena_ptr(ShmArena *arena, ShmOffset offset) {
+    return (arena == NULL || offset == SHM_NULL) ? NULL : (char *) arena + offset;
+}
+
+// Offset of a pointer into the arena
+static inline ShmOffset shm_arena_offset(ShmArena *arena, const void *ptr) {
+    return ptr == NULL ? SHM_NULL : (ShmOffset) ((const char *) ptr - (const char *) arena);
+}
+
+#endif // BAKERY_SHM_ARENA_H
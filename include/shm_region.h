@@ -0,0 +1,48 @@
+#ifndef BAKERY_SHM_REGION_H
+#define BAKERY_SHM_REGION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Most regions one simulation creates through this interface
+#define SHM_REGION_MAX 24
+
+// Longest run ID, used to namespace POSIX objects
+#define SHM_RUN_ID_LEN 32
+
+// Longest hugetlbfs mount path
+#define SHM_HUGETLBFS_DIR_LEN 128
+
+// Shared memory backends, chosen at startup with SHM_BACKEND in the config file
+typedef enum {
+    SHM_BACKEND_SYSV,   // shmget/shmat on the fixed keys in common.h (one simulation per host)
+    SHM_BACKEND_POSIX,  // shm_open/mmap on /bakery-<run id>-<name>, any number of simulations
+    SHM_BACKEND_COUNT
+} ShmBackend;
+
+// Options shared by every region of a run
+typedef struct {
+    ShmBackend backend;
+    char run_id[SHM_RUN_ID_LEN];
+    bool huge_pages;  // Huge pages for POSIX regions: hugetlbfs_dir if set, else THP advice
+    char hugetlbfs_dir[SHM_HUGETLBFS_DIR_LEN];  // hugetlbfs mount for POSIX regions ("" = none)
+    bool prefault;    // Populate page tables on every mapping instead of faulting lazily
+    size_t arena_size;  // Bytes in the shared arena for variable-size state (see shm_arena.h)
+} ShmOptions;
+
+// Function prototypes
+// Regions are identified by a small handle that forked children can pass to
+// shm_region_attach, the same way SysV segment ids were passed around before.
+// A region is mapped once, by its creator; forked children share that mapping.
+// Functions return -1 (or NULL) with errno set on failure.
+int shm_region_setup(const ShmOptions *options);
+int shm_region_create(const char *name, key_t sysv_key, size_t size, void **addr);
+void *shm_region_attach(int handle);
+void shm_region_detach(int handle, void *addr);
+void shm_region_destroy(int handle);
+bool shm_region_namespaced(void);
+ShmBackend parse_shm_backend(const char *name);
+const char *shm_backend_name(ShmBackend backend);
+
+#endif // BAKERY_SHM_REGION_H
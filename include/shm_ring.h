@@ -0,0 +1,45 @@
+#ifndef BAKERY_SHM_RING_H
+#define BAKERY_SHM_RING_H
+
+#include <stdint.h>
+#include <time.h>
+#include "common.h"
+
+// Bounded multi-producer/multi-consumer ring of fixed-size slots in shared memory.
+// Each slot carries a sequence number that tells producers and consumers whose turn
+// it is (Vyukov's design), so a push or pop is one CAS on a position counter plus a
+// copy, with no lock and no syscall. Waiting for space or data follows the ring's
+// WaitStrategy; with WAIT_FUTEX the other side only pays for a wake syscall when
+// somebody is actually asleep.
+typedef struct {
+    uint32_t capacity;   // Power of two
+    uint32_t mask;
+    uint32_t slot_size;  // Payload bytes per slot
+    uint32_t stride;     // Bytes between slots (sequence + payload, cache-line aligned)
+    WaitStrategy wait;
+
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t enqueue_pos;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t dequeue_pos;
+    _Alignas(CACHE_LINE_SIZE) WakeupChannel not_empty;
+    _Alignas(CACHE_LINE_SIZE) WakeupChannel not_full;
+
+    // Slots follow the header
+    _Alignas(CACHE_LINE_SIZE) unsigned char slots[];
+} ShmRing;
+
+// Function prototypes
+// Blocking calls return 0, or -1 with errno ETIMEDOUT when the deadline
+// (CLOCK_MONOTONIC, NULL for none) passes or EINTR when a signal arrives
+size_t shm_ring_size(uint32_t capacity, uint32_t slot_size);
+int shm_ring_init(ShmRing *ring, uint32_t capacity, uint32_t slot_size, WaitStrategy wait);
+bool shm_ring_try_push(ShmRing *ring, const void *item);
+bool shm_ring_try_pop(ShmRing *ring, void *item);
+int shm_ring_push(ShmRing *ring, const void *item, const struct timespec *deadline);
+int shm_ring_pop(ShmRing *ring, void *item, const struct timespec *deadline);
+int shm_ring_pop_first(ShmRing **rings, int count, WakeupChannel *channel, void *item,
+                       const struct timespec *deadline);
+uint32_t shm_ring_round_capacity(int requested);
+WaitStrategy parse_wait_strategy(const char *name);
+const char *wait_strategy_name(WaitStrategy wait);
+
+#endif // BAKERY_SHM_RING_H
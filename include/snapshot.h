@@ -0,0 +1,27 @@
+#ifndef BAKERY_SNAPSHOT_H
+#define BAKERY_SNAPSHOT_H
+
+#include "common.h"
+
+// Consistent private copy of ProductionStatus for read-only consumers
+typedef struct {
+    int produced_items[PRODUCT_TYPE_COUNT];
+    int sold_items[PRODUCT_TYPE_COUNT];
+    int frustrated_customers;
+    int complained_customers;
+    int missing_items_requests;
+    double total_profit;
+    time_t start_time;
+} ProductionSnapshot;
+
+// Consistent private copy of Inventory for read-only consumers
+typedef struct {
+    int quantities[ITEM_RAW_MATERIAL_COUNT];
+    int min_thresholds[ITEM_RAW_MATERIAL_COUNT];
+} InventorySnapshot;
+
+// Function prototypes
+void read_production_snapshot(ProductionStatus *status, ProductionSnapshot *snapshot);
+void read_inventory_snapshot(Inventory *inventory, InventorySnapshot *snapshot);
+
+#endif // BAKERY_SNAPSHOT_H
@@ -0,0 +1,64 @@
+#ifndef BAKERY_STATS_H
+#define BAKERY_STATS_H
+
+#include "common.h"
+
+// Customers come and go, so they share a few shards picked by customer id
+#define CUSTOMER_STAT_SHARDS 16
+
+// Shared data published through per-writer sequence locks (see seqlock.h)
+typedef enum {
+    STATS_SEQ_STATUS,     // ProductionStatus produced/sold counters
+    STATS_SEQ_INVENTORY,  // Inventory quantities
+    STATS_SEQ_COUNT
+} StatsSeqKind;
+
+// Statistics block owned by one worker (or one customer shard).
+// Aligned to a cache line so workers never write to each other's lines.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) WorkerRole role;
+    int worker_id;
+    _Atomic int items_handled;          // Items produced (chefs/bakers), sold (sellers) or restocked
+    _Atomic int frustrated_customers;
+    _Atomic int complained_customers;
+    _Atomic int missing_items_requests;
+    _Atomic int expired_orders;         // Orders skipped because the customer had given up
+    _Atomic double total_profit;
+    _Atomic int batches;                // Lock holds of a seller (see SELLER_BATCH_SIZE)
+    _Atomic int batched_orders;         // Orders served in those holds
+    _Atomic int largest_batch;
+    SeqLock seqlocks[STATS_SEQ_COUNT];  // Bumped only by this worker around its shared updates
+} WorkerStats;
+
+// Shared memory table holding every shard
+typedef struct {
+    int num_shards;
+    int role_first[ROLE_COUNT];  // Index of the first shard of each role
+    int role_count[ROLE_COUNT];  // Number of shards of each role
+    WorkerStats shards[];
+} StatsTable;
+
+// Totals merged from all shards on demand
+typedef struct {
+    int items_handled[ROLE_COUNT];
+    int frustrated_customers;
+    int complained_customers;
+    int missing_items_requests;
+    int expired_orders;
+    double total_profit;
+} StatsTotals;
+
+// Function prototypes
+int stats_create(BakeryConfig config);
+void stats_bind_worker(WorkerRole role, int index);
+WorkerStats *stats_local(void);
+void stats_merge(StatsTotals *totals);
+void stats_print_workers(WorkerRole role, const char *label);
+void stats_record_batch(int orders);
+SeqLock *stats_seqlock(StatsSeqKind kind);
+unsigned int stats_seq_read_begin(StatsSeqKind kind);
+bool stats_seq_read_retry(StatsSeqKind kind, unsigned int start);
+void stats_print_batches(void);
+void stats_destroy(int stats_shm_id);
+
+#endif // BAKERY_STATS_H
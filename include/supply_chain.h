@@ -12,7 +12,7 @@ typedef struct {
 
 // Function prototypes
 void supply_chain_process(int id, int inventory_shm_id, int prod_status_shm_id,
-                    int inventory_sem_id, int management_msgq_id, BakeryConfig config);
+                    int management_msgq_id, BakeryConfig config);
 void purchase_materials(Inventory *inventory, BakeryConfig config, int employee_id);
 void check_inventory_levels(Inventory *inventory, int management_msgq_id);
 void initialize_inventory(Inventory *inventory, BakeryConfig config);
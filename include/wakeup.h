@@ -0,0 +1,22 @@
+#ifndef BAKERY_WAKEUP_H
+#define BAKERY_WAKEUP_H
+
+#include <stdatomic.h>
+
+// Wait/notify channel that lives in shared memory, built on a futex word.
+// A waiter reads the generation with wakeup_prepare() while the condition it
+// waits for is still known to be false (e.g. under the item lock), then blocks
+// in wakeup_wait() until a notifier bumps the generation or the timeout passes.
+// Notifiers skip the wake syscall when nobody is waiting.
+typedef struct {
+    _Atomic unsigned int generation;  // Futex word, bumped by every notify
+    _Atomic int waiters;              // Processes blocked (or about to block) on the word
+} WakeupChannel;
+
+// Function prototypes
+unsigned int wakeup_prepare(WakeupChannel *channel);
+int wakeup_wait(WakeupChannel *channel, unsigned int seen, int timeout_ms);
+void wakeup_notify(WakeupChannel *channel);
+void wakeup_notify_one(WakeupChannel *channel);
+
+#endif // BAKERY_WAKEUP_H
@@ -0,0 +1,19 @@
+#ifndef BAKERY_WIP_LEDGER_H
+#define BAKERY_WIP_LEDGER_H
+
+#include "common.h"
+
+// Lock-free ledger for intermediate goods (paste, bread).
+// Consumers reserve their inputs in one atomic step, then either commit the
+// reservation once the product is made or abort it to hand the items back,
+// so two chefs can never both take the last unit.
+
+// Function prototypes
+void wip_deposit(WipLedger *ledger, WipItem item, int quantity);
+bool wip_reserve(WipLedger *ledger, WipItem item, int quantity);
+void wip_commit(WipLedger *ledger, WipItem item, int quantity);
+void wip_abort(WipLedger *ledger, WipItem item, int quantity);
+int wip_available(WipLedger *ledger, WipItem item);
+bool wip_item_for_product(ProductType product_type, WipItem *item);
+
+#endif // BAKERY_WIP_LEDGER_H
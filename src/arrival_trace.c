@@ -0,0 +1,352 @@
+#include "../include/arrival_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Records collected before each write(); stdio is avoided on purpose, because
+// customer processes forked from the generator would flush a FILE buffer again
+#define TRACE_BUFFER_BYTES (256 * 1024)
+
+// Replayed bytes handed back to the kernel at a time
+#define TRACE_RELEASE_BYTES (16UL * 1024 * 1024)
+
+static ArrivalTraceMode trace_mode = ARRIVAL_TRACE_OFF;
+static char trace_path[ARRIVAL_TRACE_PATH_LEN];
+static BakeryConfig trace_config;
+
+// Recording: the parent creates the file, the customer generator writes it
+static int trace_fd = -1;
+static unsigned char trace_buffer[TRACE_BUFFER_BYTES];
+static size_t trace_buffered = 0;
+static uint64_t trace_records = 0;
+static uint64_t trace_duration_ns = 0;
+static pid_t trace_writer = 0;      // Process that records; every child inherits trace_fd
+
+// Replay: the parent maps the file, the customer generator reads it
+static const unsigned char *trace_map = NULL;
+static size_t trace_map_size = 0;
+static size_t trace_cursor = 0;     // Offset of the next record
+static size_t trace_released = 0;   // Bytes before this were dropped from memory
+static unsigned long trace_replayed = 0;
+static unsigned long trace_remapped = 0;  // Lines whose subtype this configuration lacks
+
+// Write all of buffer, retrying short writes
+static int write_all(int fd, const void *buffer, size_t size) {
+    const unsigned char *bytes = buffer;
+
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return 0;
+}
+
+// Header for a trace of num_records arrivals
+static void fill_header(TraceHeader *header, uint64_t num_records, uint64_t duration_ns) {
+    memset(header, 0, sizeof(TraceHeader));
+    memcpy(header->magic, ARRIVAL_TRACE_MAGIC, sizeof(header->magic));
+    header->version = ARRIVAL_TRACE_VERSION;
+    header->header_size = sizeof(TraceHeader);
+    header->num_records = num_records;
+    header->duration_ns = duration_ns;
+}
+
+// Write out the buffered records. SIGINT and SIGTERM wait until the buffer is
+// empty again, so arrival_trace_finish_on_signal never writes records twice
+static int flush_records(void) {
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop_signals, &old_mask);
+
+    int rc = write_all(trace_fd, trace_buffer, trace_buffered);
+    if (rc == 0) {
+        trace_buffered = 0;
+    }
+
+    int saved_errno = errno;
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    errno = saved_errno;
+    return rc;
+}
+
+// Drop pages the replay has moved past, so a long trace does not stay resident
+static void release_replayed(void) {
+    if (trace_cursor - trace_released < TRACE_RELEASE_BYTES) {
+        return;
+    }
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t end = trace_cursor & ~(page_size - 1);
+
+    madvise((void *) (trace_map + trace_released), end - trace_released, MADV_DONTNEED);
+    trace_released = end;
+}
+
+// Map a trace for replay and check its header
+static int open_replay(void) {
+    int fd = open(trace_path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    if ((size_t) st.st_size < sizeof(TraceHeader)) {
+        close(fd);
+        fprintf(stderr, "%s is too short to be an arrival trace\n", trace_path);
+        errno = EBADMSG;
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved_errno = errno;
+    close(fd);  // The mapping stays valid
+    if (map == MAP_FAILED) {
+        errno = saved_errno;
+        return -1;
+    }
+    trace_map = map;
+    trace_map_size = st.st_size;
+
+    const TraceHeader *header = (const TraceHeader *) trace_map;
+    if (memcmp(header->magic, ARRIVAL_TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != ARRIVAL_TRACE_VERSION ||
+        header->header_size < sizeof(TraceHeader) || header->header_size > trace_map_size) {
+        fprintf(stderr, "%s is not an arrival trace this version can replay\n", trace_path);
+        arrival_trace_destroy();
+        errno = EBADMSG;
+        return -1;
+    }
+
+    madvise((void *) trace_map, trace_map_size, MADV_SEQUENTIAL);
+    trace_cursor = header->header_size;
+
+    if (header->num_records > 0) {
+        printf("Replaying %llu customer arrivals over %.1f s from %s\n",
+               (unsigned long long) header->num_records, header->duration_ns / 1e9, trace_path);
+    } else {
+        printf("Replaying customer arrivals from %s (unfinished recording)\n", trace_path);
+    }
+    return 0;
+}
+
+// Create the trace file or map the trace to replay (called by the parent)
+int arrival_trace_create(BakeryConfig config) {
+    trace_mode = config.arrival_trace;
+    if (trace_mode == ARRIVAL_TRACE_OFF) {
+        return 0;
+    }
+
+    trace_config = config;
+    snprintf(trace_path, sizeof(trace_path), "%s", config.arrival_trace_file);
+
+    if (trace_mode == ARRIVAL_TRACE_REPLAY) {
+        return open_replay();
+    }
+
+    trace_fd = open(trace_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (trace_fd == -1) {
+        return -1;
+    }
+
+    TraceHeader header;
+    fill_header(&header, 0, 0);
+    if (write_all(trace_fd, &header, sizeof(header)) == -1) {
+        int saved_errno = errno;
+        arrival_trace_destroy();
+        errno = saved_errno;
+        return -1;
+    }
+
+    printf("Recording customer arrivals to %s\n", trace_path);
+    return 0;
+}
+
+// Append an arrival scheduled offset_ns after the start of the run (no-op unless recording)
+int arrival_trace_record(const CustomerArrival *arrival, uint64_t offset_ns) {
+    if (trace_fd == -1) {
+        return 0;
+    }
+    trace_writer = getpid();
+
+    const CustomerMsg *request = &arrival->request;
+    size_t size = sizeof(TraceRecord) + (size_t) request->num_lines * sizeof(TraceLine);
+
+    if (trace_buffered + size > TRACE_BUFFER_BYTES && flush_records() == -1) {
+        return -1;
+    }
+
+    TraceRecord *record = (TraceRecord *) (trace_buffer + trace_buffered);
+    record->offset_ns = offset_ns;
+    record->customer_id = arrival->customer_id;
+    record->patience = arrival->patience > UINT16_MAX ? UINT16_MAX : arrival->patience;
+    record->order_class = request->order_class;
+    record->num_lines = request->num_lines;
+
+    TraceLine *lines = (TraceLine *) (record + 1);
+    for (int i = 0; i < request->num_lines; i++) {
+        lines[i].product_type = request->lines[i].product_type;
+        lines[i].subtype = request->lines[i].subtype;
+        lines[i].quantity = request->lines[i].quantity;
+    }
+
+    // The record counts only once trace_buffered covers it, so a signal flushing the buffer
+    // in between writes at worst a record the header does not count yet
+    trace_buffered += size;
+    trace_records++;
+    trace_duration_ns = offset_ns;
+    return 0;
+}
+
+// Decode the next arrival of the replayed trace
+int arrival_trace_next(CustomerArrival *arrival, uint64_t *offset_ns) {
+    if (trace_map == NULL || trace_cursor + sizeof(TraceRecord) > trace_map_size) {
+        errno = ENODATA;
+        return -1;
+    }
+
+    const TraceRecord *record = (const TraceRecord *) (trace_map + trace_cursor);
+    size_t size = sizeof(TraceRecord) + (size_t) record->num_lines * sizeof(TraceLine);
+
+    // A record cut short means the recorder was stopped while writing it
+    if (trace_cursor + size > trace_map_size) {
+        errno = ENODATA;
+        return -1;
+    }
+
+    if (record->num_lines == 0 || record->num_lines > MAX_BASKET_LINES ||
+        record->order_class >= ORDER_CLASS_COUNT) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    memset(arrival, 0, sizeof(CustomerArrival));
+    arrival->customer_id = record->customer_id;
+    arrival->patience = record->patience;
+
+    CustomerMsg *request = &arrival->request;
+    request->msg_type = MSG_CUSTOMER_REQUEST;
+    request->customer_id = record->customer_id;
+    request->order_class = record->order_class;
+    request->num_lines = record->num_lines;
+    request->reply_slot = -1;
+
+    const TraceLine *lines = (const TraceLine *) (record + 1);
+    for (int i = 0; i < record->num_lines; i++) {
+        if (lines[i].product_type >= PRODUCT_TYPE_COUNT) {
+            errno = EBADMSG;
+            return -1;
+        }
+
+        // A trace recorded with more subtypes than this configuration has is folded into range
+        int num_subtypes = trace_config.num_categories[lines[i].product_type];
+        int subtype = lines[i].subtype;
+        if (subtype >= (num_subtypes > 0 ? num_subtypes : 1)) {
+            subtype = num_subtypes > 0 ? subtype % num_subtypes : 0;
+            trace_remapped++;
+        }
+
+        request->lines[i].product_type = lines[i].product_type;
+        request->lines[i].subtype = subtype;
+        request->lines[i].quantity = lines[i].quantity;
+    }
+
+    *offset_ns = record->offset_ns;
+    trace_cursor += size;
+    trace_replayed++;
+    release_replayed();
+    return 0;
+}
+
+// True if the customer generator should take its arrivals from the trace
+bool arrival_trace_replaying(void) {
+    return trace_map != NULL;
+}
+
+// Complete the trace (called by the customer generator when it stops)
+void arrival_trace_finish(void) {
+    if (trace_fd != -1) {
+        TraceHeader header;
+        fill_header(&header, trace_records, trace_duration_ns);
+
+        if (flush_records() == -1 ||
+            pwrite(trace_fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+            perror("Failed to complete the arrival trace");
+        } else {
+            printf("Recorded %llu customer arrivals to %s\n",
+                   (unsigned long long) trace_records, trace_path);
+        }
+
+        close(trace_fd);
+        trace_fd = -1;
+    } else if (trace_map != NULL) {
+        printf("Replayed %lu customer arrivals from %s\n", trace_replayed, trace_path);
+        if (trace_remapped > 0) {
+            printf("  %lu basket lines named a subtype this configuration does not have\n",
+                   trace_remapped);
+        }
+    }
+}
+
+// Write out what the customer generator recorded when a signal stops it before
+// arrival_trace_finish. Only uses write and pwrite, so it is safe in a signal handler;
+// other processes, which inherit the file but never record, leave it alone
+void arrival_trace_finish_on_signal(void) {
+    if (trace_fd == -1 || trace_writer != getpid()) {
+        return;
+    }
+
+    TraceHeader header;
+    fill_header(&header, trace_records, trace_duration_ns);
+    if (write_all(trace_fd, trace_buffer, trace_buffered) == 0) {
+        pwrite(trace_fd, &header, sizeof(header), 0);
+    }
+    trace_fd = -1;
+}
+
+// Close the trace without writing to it (called by the parent during cleanup)
+void arrival_trace_destroy(void) {
+    if (trace_fd != -1) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+
+    if (trace_map != NULL) {
+        munmap((void *) trace_map, trace_map_size);
+        trace_map = NULL;
+        trace_map_size = 0;
+    }
+}
+
+// Parse an arrival trace mode from the config file
+ArrivalTraceMode parse_arrival_trace_mode(const char *name) {
+    if (strncmp(name, "record", 6) == 0) {
+        return ARRIVAL_TRACE_RECORD;
+    } else if (strncmp(name, "replay", 6) == 0) {
+        return ARRIVAL_TRACE_REPLAY;
+    } else if (strncmp(name, "off", 3) != 0) {
+        fprintf(stderr, "Unknown arrival trace mode '%s', using off\n", name);
+    }
+    return ARRIVAL_TRACE_OFF;
+}
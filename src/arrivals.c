@@ -0,0 +1,227 @@
+#include "../include/arrivals.h"
+#include "../include/histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Longest single sleep, so the end of the simulation is noticed between far-apart arrivals
+#define ARRIVAL_POLL_NS 1000000000ULL  // 1s
+
+// Created by the parent before forking, so the generator and management inherit the mapping
+static ArrivalBoard *arrival_board = NULL;
+static int arrival_board_shm_id = -1;
+
+// Uniform random number in (0, 1]
+static double uniform01(void) {
+    return (rand() + 1.0) / ((double) RAND_MAX + 1.0);
+}
+
+// Seconds from this arrival to the next one
+static double next_gap_s(ArrivalSchedule *schedule) {
+    switch (schedule->process) {
+        case ARRIVAL_POISSON:
+            return -log(uniform01()) / schedule->rate;
+        case ARRIVAL_BURSTY:
+            // The rest of a burst comes in together
+            if (--schedule->burst_left > 0) {
+                return 0.0;
+            }
+            schedule->burst_left = schedule->burst_size;
+            return -log(uniform01()) * schedule->burst_size / schedule->rate;
+        default:
+            return schedule->min_gap_s + (schedule->max_gap_s - schedule->min_gap_s) * uniform01();
+    }
+}
+
+// Count an arrival that started lag_ns after its scheduled time
+static void record_arrival(uint64_t now, uint64_t lag_ns) {
+    uint64_t first_ns = 0;
+
+    atomic_compare_exchange_strong_explicit(&arrival_board->first_ns, &first_ns, now,
+                                            memory_order_relaxed, memory_order_relaxed);
+    atomic_store_explicit(&arrival_board->last_ns, now, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arrival_board->arrivals, 1, memory_order_relaxed);
+
+    if (lag_ns > ARRIVAL_LATE_NS) {
+        atomic_fetch_add_explicit(&arrival_board->late, 1, memory_order_relaxed);
+    }
+    if (lag_ns > atomic_load_explicit(&arrival_board->max_lag_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&arrival_board->max_lag_ns, lag_ns, memory_order_relaxed);
+    }
+}
+
+// Create the shared arrival counters (called by the parent)
+int arrivals_create(BakeryConfig config) {
+    arrival_board_shm_id = shm_region_create("arrivals", IPC_PRIVATE, sizeof(ArrivalBoard),
+                                             (void **) &arrival_board);
+    if (arrival_board_shm_id == -1) {
+        return -1;
+    }
+
+    arrival_board->process = config.arrival_process;
+    return 0;
+}
+
+// Customers per second the config asks for, before clamping
+static double configured_rate(BakeryConfig config) {
+    double mean_interval = (config.customer_params[0] + config.customer_params[1]) / 2.0;
+
+    return config.arrival_rate > 0 ? config.arrival_rate
+           : mean_interval > 0 ? 1.0 / mean_interval : 1.0;
+}
+
+// Customers per second the generator will offer (used to size queues)
+double arrivals_offered_rate(BakeryConfig config) {
+    double rate = configured_rate(config);
+
+    return rate < ARRIVAL_RATE_MIN ? ARRIVAL_RATE_MIN
+           : rate > ARRIVAL_RATE_MAX ? ARRIVAL_RATE_MAX : rate;
+}
+
+// Work out the schedule from the config; the first customer arrives right away
+void arrival_schedule_init(ArrivalSchedule *schedule, BakeryConfig config) {
+    double min_interval = config.customer_params[0];
+    double max_interval = config.customer_params[1];
+    double mean_interval = (min_interval + max_interval) / 2.0;
+
+    // Uniform gaps follow the configured intervals unless a rate overrides them
+    bool from_intervals = config.arrival_rate <= 0 && mean_interval > 0;
+
+    schedule->process = config.arrival_process;
+    schedule->rate = configured_rate(config);
+
+    if (schedule->rate < ARRIVAL_RATE_MIN || schedule->rate > ARRIVAL_RATE_MAX) {
+        double rate = schedule->rate < ARRIVAL_RATE_MIN ? ARRIVAL_RATE_MIN : ARRIVAL_RATE_MAX;
+        fprintf(stderr, "Arrival rate %.4f/s out of range, using %.2f/s\n", schedule->rate, rate);
+        schedule->rate = rate;
+        from_intervals = false;
+    }
+
+    if (from_intervals) {
+        schedule->min_gap_s = min_interval < max_interval ? min_interval : max_interval;
+        schedule->max_gap_s = min_interval < max_interval ? max_interval : min_interval;
+    } else {
+        schedule->min_gap_s = 0.5 / schedule->rate;
+        schedule->max_gap_s = 1.5 / schedule->rate;
+    }
+
+    schedule->burst_size = config.arrival_burst_size > 0 ? config.arrival_burst_size : 1;
+    schedule->burst_left = schedule->burst_size;
+    schedule->replay = config.arrival_trace == ARRIVAL_TRACE_REPLAY;
+    schedule->start_ns = histogram_now_ns();
+    schedule->next_ns = schedule->start_ns;
+    schedule->due_ns = schedule->start_ns;
+
+    arrival_board->replay = schedule->replay;
+    arrival_board->target_rate = schedule->rate;
+    if (!schedule->replay) {
+        printf("Customers arrive %s at %.2f/s\n", arrival_process_name(schedule->process),
+               schedule->rate);
+    }
+    // Flush before customers are forked, or each child repeats the line
+    fflush(stdout);
+}
+
+// Schedule the next arrival offset_ns after the first one (trace replay)
+void arrival_schedule_at(ArrivalSchedule *schedule, uint64_t offset_ns) {
+    schedule->next_ns = schedule->start_ns + offset_ns;
+}
+
+// Sleep until the next scheduled arrival; false if the simulation ended first
+bool arrival_wait(ArrivalSchedule *schedule, const ProductionStatus *status) {
+    while (status->simulation_active) {
+        uint64_t now = histogram_now_ns();
+
+        if (now >= schedule->next_ns) {
+            record_arrival(now, now - schedule->next_ns);
+            schedule->due_ns = schedule->next_ns;
+
+            // Advance from the scheduled time, not from now, so delays do not accumulate
+            if (!schedule->replay) {
+                schedule->next_ns += (uint64_t) (next_gap_s(schedule) * 1e9);
+            }
+            return true;
+        }
+
+        uint64_t wake_ns = schedule->next_ns - now > ARRIVAL_POLL_NS ? now + ARRIVAL_POLL_NS
+                                                                      : schedule->next_ns;
+        struct timespec wake = {
+            .tv_sec = wake_ns / 1000000000ULL,
+            .tv_nsec = wake_ns % 1000000000ULL
+        };
+
+        // Interrupted sleeps simply go round again
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    }
+
+    return false;
+}
+
+// Customers that have arrived so far
+unsigned long arrivals_count(void) {
+    if (arrival_board == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&arrival_board->arrivals, memory_order_relaxed);
+}
+
+// Print the offered load (used by the summary)
+void arrivals_print(void) {
+    if (arrival_board == NULL) {
+        return;
+    }
+
+    unsigned long arrivals = atomic_load_explicit(&arrival_board->arrivals, memory_order_relaxed);
+    uint64_t first_ns = atomic_load_explicit(&arrival_board->first_ns, memory_order_relaxed);
+    uint64_t last_ns = atomic_load_explicit(&arrival_board->last_ns, memory_order_relaxed);
+    double elapsed_s = (last_ns - first_ns) / 1e9;
+    char source[48];
+
+    if (arrival_board->replay) {
+        snprintf(source, sizeof(source), "trace replay");
+    } else {
+        snprintf(source, sizeof(source), "%s, target %.2f/s",
+                 arrival_process_name(arrival_board->process), arrival_board->target_rate);
+    }
+
+    printf("Arrivals (%s): %lu customers in %.1f s (%.2f/s), %lu late, max lag %.1f ms\n",
+           source, arrivals, elapsed_s, elapsed_s > 0 ? (arrivals - 1) / elapsed_s : 0.0,
+           atomic_load_explicit(&arrival_board->late, memory_order_relaxed),
+           atomic_load_explicit(&arrival_board->max_lag_ns, memory_order_relaxed) / 1e6);
+}
+
+// Remove the shared counters (called by the parent during cleanup)
+void arrivals_destroy(void) {
+    if (arrival_board_shm_id != -1) {
+        shm_region_destroy(arrival_board_shm_id);
+        arrival_board_shm_id = -1;
+        arrival_board = NULL;
+    }
+}
+
+// Parse an arrival process name from the config file
+ArrivalProcess parse_arrival_process(const char *name) {
+    if (strncmp(name, "poisson", 7) == 0) {
+        return ARRIVAL_POISSON;
+    } else if (strncmp(name, "bursty", 6) == 0) {
+        return ARRIVAL_BURSTY;
+    } else if (strncmp(name, "uniform", 7) != 0) {
+        fprintf(stderr, "Unknown arrival process '%s', using uniform\n", name);
+    }
+    return ARRIVAL_UNIFORM;
+}
+
+// Human readable arrival process name for logging
+const char *arrival_process_name(ArrivalProcess process) {
+    const char *names[] = {"uniform", "poisson", "bursty"};
+
+    if (process < 0 || process >= ARRIVAL_PROCESS_COUNT) {
+        return "unknown";
+    }
+    return names[process];
+}
@@ -1,4 +1,7 @@
 #include "../include/baker.h"
+#include "../include/counters.h"
+#include "../include/stats.h"
+#include "../include/wip_ledger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -10,28 +13,29 @@
 
 // Baker process main function
 void baker_process(BakerType type, int id, int inventory_shm_id, int prod_status_shm_id,
-                  int inventory_sem_id, int prod_sem_id, BakeryConfig config) {
+                  BakeryConfig config) {
     
     // Attach to shared memory segments
-    Inventory *inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    Inventory *inventory = (Inventory *) shm_region_attach(inventory_shm_id);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (inventory == (void *) -1 || status == (void *) -1) {
+    if (inventory == NULL || status == NULL) {
         perror("Baker: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Define semaphore operations
-    struct sembuf inventory_lock = {0, -1, 0};   // Lock inventory
-    struct sembuf inventory_unlock = {0, 1, 0};  // Unlock inventory
-    struct sembuf prod_lock = {0, -1, 0};        // Lock production status
-    struct sembuf prod_unlock = {0, 1, 0};       // Unlock production status
-    
     // Baker type string for logging
     const char *baker_types[] = {
         "Cake and Sweet", "Patisserie", "Bread"
     };
     
+    // Bakers are numbered across all teams for their statistics shard
+    int baker_index = id;
+    for (int t = 0; t < type; t++) {
+        baker_index += config.num_bakers[t];
+    }
+    stats_bind_worker(ROLE_BAKER, baker_index);
+    
     printf("Baker %d of type %s started (PID: %d)\n", id, baker_types[type], getpid());
     
     // Main processing loop
@@ -39,7 +43,8 @@ void baker_process(BakerType type, int id, int inventory_shm_id, int prod_status
         bool baked_something = false;
         
         // Lock production status to check and update
-        if (semop(prod_sem_id, &prod_lock, 1) == -1) {
+        // (in atomic counter mode every update is a bounded CAS, so no lock is needed)
+        if (!config.atomic_counters && bakery_lock_acquire(&status->lock) == -1) {
             perror("Baker: Failed to lock production status semaphore");
             break;
         }
@@ -48,7 +53,7 @@ void baker_process(BakerType type, int id, int inventory_shm_id, int prod_status
         baked_something = bake_products(type, status, config);
         
         // Unlock production status
-        if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
+        if (!config.atomic_counters && bakery_lock_release(&status->lock) == -1) {
             perror("Baker: Failed to unlock production status semaphore");
             break;
         }
@@ -84,65 +89,78 @@ void baker_process(BakerType type, int id, int inventory_shm_id, int prod_status
     printf("Baker %d of type %s terminating (PID: %d)\n", id, baker_types[type], getpid());
     
     // Detach from shared memory
-    shmdt(inventory);
-    shmdt(status);
+    shm_region_detach(inventory_shm_id, inventory);
+    shm_region_detach(prod_status_shm_id, status);
+}
+
+// Count one more item of a product if it stays under its limit,
+// published through the status seqlock so snapshots never see half an update
+static bool produce_below_limit(ProductionStatus *status, ProductType type,
+                                BakeryConfig config, int *total) {
+    seqlock_write_begin(stats_seqlock(STATS_SEQ_STATUS));
+    bool produced = counter_increment_below(&status->produced_items[type],
+                                            config.max_items_per_type[type], total);
+    seqlock_write_end(stats_seqlock(STATS_SEQ_STATUS));
+    
+    if (produced) {
+        counter_add(&stats_local()->items_handled, 1);
+        
+        // Bread also feeds the sandwich chefs through the WIP ledger
+        WipItem wip_item;
+        if (wip_item_for_product(type, &wip_item)) {
+            wip_deposit(&status->wip, wip_item, 1);
+        }
+    }
+    
+    return produced;
 }
 
 // Bake products based on baker type
 bool bake_products(BakerType type, ProductionStatus *status, BakeryConfig config) {
     bool baked_something = false;
+    int total = 0;
     
     switch (type) {
         case BAKER_CAKE_SWEET:
             // Check if we should bake more cakes (limit to 100)
-            if (status->produced_items[PRODUCT_CAKE] < config.max_items_per_type[PRODUCT_CAKE]) {
+            if (produce_below_limit(status, PRODUCT_CAKE, config, &total)) {
                 // Simulate baking a cake
-                status->produced_items[PRODUCT_CAKE]++;
-                printf("Baker baked a cake. Total: %d\n", status->produced_items[PRODUCT_CAKE]);
+                printf("Baker baked a cake. Total: %d\n", total);
                 baked_something = true;
             } 
-            else if (status->produced_items[PRODUCT_SWEET] < config.max_items_per_type[PRODUCT_SWEET]) {
+            else if (produce_below_limit(status, PRODUCT_SWEET, config, &total)) {
                 // Simulate baking sweets
-                status->produced_items[PRODUCT_SWEET]++;
-                printf("Baker baked sweets. Total: %d\n", status->produced_items[PRODUCT_SWEET]);
+                printf("Baker baked sweets. Total: %d\n", total);
                 baked_something = true;
             }
             break;
             
         case BAKER_PATISSERIE:
             // Check if we should bake more patisseries
-            if (status->produced_items[PRODUCT_SWEET_PATISSERIE] < 
-                config.max_items_per_type[PRODUCT_SWEET_PATISSERIE]) {
+            if (produce_below_limit(status, PRODUCT_SWEET_PATISSERIE, config, &total)) {
                 // Simulate baking sweet patisserie
-                status->produced_items[PRODUCT_SWEET_PATISSERIE]++;
-                printf("Baker baked a sweet patisserie. Total: %d\n", 
-                       status->produced_items[PRODUCT_SWEET_PATISSERIE]);
+                printf("Baker baked a sweet patisserie. Total: %d\n", total);
                 baked_something = true;
             }
-            else if (status->produced_items[PRODUCT_SAVORY_PATISSERIE] < 
-                     config.max_items_per_type[PRODUCT_SAVORY_PATISSERIE]) {
+            else if (produce_below_limit(status, PRODUCT_SAVORY_PATISSERIE, config, &total)) {
                 // Simulate baking savory patisserie
-                status->produced_items[PRODUCT_SAVORY_PATISSERIE]++;
-                printf("Baker baked a savory patisserie. Total: %d\n", 
-                       status->produced_items[PRODUCT_SAVORY_PATISSERIE]);
+                printf("Baker baked a savory patisserie. Total: %d\n", total);
                 baked_something = true;
             }
             break;
             
         case BAKER_BREAD:
             // Check if we should bake more bread
-            if (status->produced_items[PRODUCT_BREAD] < config.max_items_per_type[PRODUCT_BREAD]) {
+            if (produce_below_limit(status, PRODUCT_BREAD, config, &total)) {
                 // Simulate baking bread
-                status->produced_items[PRODUCT_BREAD]++;
-                printf("Baker baked bread. Total: %d\n", status->produced_items[PRODUCT_BREAD]);
+                printf("Baker baked bread. Total: %d\n", total);
                 baked_something = true;
             }
             
             // Also handle sandwich production if bread baker is responsible
-            if (status->produced_items[PRODUCT_SANDWICH] < config.max_items_per_type[PRODUCT_SANDWICH]) {
+            if (produce_below_limit(status, PRODUCT_SANDWICH, config, &total)) {
                 // Simulate making sandwich
-                status->produced_items[PRODUCT_SANDWICH]++;
-                printf("Baker made sandwich. Total: %d\n", status->produced_items[PRODUCT_SANDWICH]);
+                printf("Baker made sandwich. Total: %d\n", total);
                 baked_something = true;
             }
             break;
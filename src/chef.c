@@ -1,6 +1,10 @@
 #include "../include/chef.h"
+#include "../include/counters.h"
+#include "../include/stats.h"
+#include "../include/wip_ledger.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
@@ -8,69 +12,95 @@
 #include <sys/sem.h>
 #include <sys/msg.h>
 
-// Check if chef has the necessary ingredients for production
-bool check_dependencies(ChefType type, Inventory *inventory) {
+// Delay before retrying when another process holds one of our ingredients
+#define INGREDIENT_RETRY_DELAY_US 10000  // 10ms
+
+// Longest waits for missing paste/bread and raw materials; with event wakeups
+// chefs return earlier as soon as they are notified
+#define WIP_WAIT_SECONDS 2
+#define INGREDIENT_WAIT_SECONDS 3
+
+// Raw materials consumed by one item of each chef type
+static const int recipes[CHEF_TYPE_COUNT][ITEM_RAW_MATERIAL_COUNT] = {
+    //                        Wheat Yeast Butter Milk Sugar Sweets Cheese
+    [CHEF_PASTE]             = {2,    1,    1,     1,   0,    0,     0},  // plus water
+    [CHEF_CAKE]              = {3,    0,    2,     2,   2,    2,     0},  // sweet items stand in for eggs
+    [CHEF_SANDWICH]          = {0,    0,    0,     0,   0,    0,     2},  // plus bread
+    [CHEF_SWEET]             = {0,    0,    0,     0,   2,    3,     0},
+    [CHEF_SWEET_PATISSERIE]  = {0,    0,    0,     0,   1,    2,     0},  // plus paste
+    [CHEF_SAVORY_PATISSERIE] = {0,    0,    1,     0,   0,    0,     1},  // plus paste
+};
+
+// Intermediate product a chef type consumes besides raw materials; false if none
+static bool recipe_wip_input(ChefType type, WipItem *item) {
     switch (type) {
-        case CHEF_PASTE:
-            // Paste requires wheat, yeast, butter, and water (milk)
-            if (inventory->quantities[ITEM_WHEAT] < 2 || 
-                inventory->quantities[ITEM_YEAST] < 1 || 
-                inventory->quantities[ITEM_BUTTER] < 1 || 
-                inventory->quantities[ITEM_MILK] < 1) {
-                return false;
-            }
-            return true;
-            
-        case CHEF_CAKE:
-            // Cakes require flour (wheat), butter, milk, sugar/salt, eggs (sweet items)
-            if (inventory->quantities[ITEM_WHEAT] < 3 || 
-                inventory->quantities[ITEM_BUTTER] < 2 || 
-                inventory->quantities[ITEM_MILK] < 2 ||
-                inventory->quantities[ITEM_SUGAR_SALT] < 2 ||
-                inventory->quantities[ITEM_SWEET_ITEMS] < 2) {
-                return false;
-            }
-            return true;
-            
         case CHEF_SANDWICH:
-            // Sandwiches require bread (check if available) and cheese/salami
-            if (inventory->quantities[ITEM_CHEESE_SALAMI] < 2) {
-                return false;
-            }
+            *item = WIP_BREAD;
             return true;
-            
-        case CHEF_SWEET:
-            // Sweets require sugar/salt and sweet items
-            if (inventory->quantities[ITEM_SUGAR_SALT] < 2 ||
-                inventory->quantities[ITEM_SWEET_ITEMS] < 3) {
-                return false;
-            }
-            return true;
-            
         case CHEF_SWEET_PATISSERIE:
-            // Sweet patisseries require paste, sweet items, and sugar
-            // We'll check if PRODUCT_PASTE is available in produce_item
-            if (inventory->quantities[ITEM_SWEET_ITEMS] < 2 ||
-                inventory->quantities[ITEM_SUGAR_SALT] < 1) {
-                return false;
-            }
-            return true;
-            
         case CHEF_SAVORY_PATISSERIE:
-            // Savory patisseries require paste, cheese/salami, and butter
-            // We'll check if PRODUCT_PASTE is available in produce_item
-            if (inventory->quantities[ITEM_CHEESE_SALAMI] < 1 ||
-                inventory->quantities[ITEM_BUTTER] < 1) {
-                return false;
-            }
+            *item = WIP_PASTE;
             return true;
-            
         default:
             return false;
     }
 }
 
+// Fill items with the raw materials a chef type uses, in ascending order; returns the count
+static int recipe_ingredients(ChefType type, int *items) {
+    int count = 0;
+    
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        if (recipes[type][i] > 0) {
+            items[count++] = i;
+        }
+    }
+    
+    return count;
+}
+
+// First raw material the recipe is short of, or -1 if everything is in stock
+// (the caller must hold the locks of the ingredients in the recipe)
+static int missing_ingredient(ChefType type, Inventory *inventory) {
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        if (inventory->quantities[i] < recipes[type][i]) {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+// Sleep until the channel is notified (event wakeups) or for the full time (polling)
+static void wait_for_supplies(WakeupChannel *channel, unsigned int seen, int seconds,
+                              BakeryConfig config) {
+    if (!config.event_wakeups) {
+        sleep(seconds);
+        return;
+    }
+    
+    // The timeout keeps us checking simulation_active during long droughts
+    if (wakeup_wait(channel, seen, seconds * 1000) == -1 &&
+        errno != ETIMEDOUT && errno != EINTR) {
+        perror("Chef: Failed to wait for supplies");
+        sleep(seconds);
+    }
+}
+
+// Check if chef has the necessary ingredients for production
+// (the caller must hold the locks of the ingredients in the recipe)
+bool check_dependencies(ChefType type, Inventory *inventory) {
+    if (type < 0 || type >= CHEF_TYPE_COUNT) {
+        return false;
+    }
+    
+    // Paste and bread are reserved separately through the WIP ledger
+    return missing_ingredient(type, inventory) == -1;
+}
+
 // Produce an item (consume ingredients and update production status)
+// The caller holds the recipe's ingredient locks and, for chefs that need paste
+// or bread, a WIP reservation of one unit that is committed here
 void produce_item(ChefType type, Inventory *inventory, ProductionStatus *status, BakeryConfig config) {
     // No need for semaphores here as locking/unlocking is handled by the calling function
     
@@ -79,84 +109,86 @@ void produce_item(ChefType type, Inventory *inventory, ProductionStatus *status,
     switch (type) {
         case CHEF_PASTE:
             product_type = PRODUCT_PASTE;
-            // Consume ingredients for paste
-            inventory->quantities[ITEM_WHEAT] -= 2;
-            inventory->quantities[ITEM_YEAST] -= 1;
-            inventory->quantities[ITEM_BUTTER] -= 1;
-            inventory->quantities[ITEM_MILK] -= 1;
             break;
-            
         case CHEF_CAKE:
             product_type = PRODUCT_CAKE;
-            // Consume ingredients for cake
-            inventory->quantities[ITEM_WHEAT] -= 3;
-            inventory->quantities[ITEM_BUTTER] -= 2;
-            inventory->quantities[ITEM_MILK] -= 2;
-            inventory->quantities[ITEM_SUGAR_SALT] -= 2;
-            inventory->quantities[ITEM_SWEET_ITEMS] -= 2;
             break;
-            
         case CHEF_SANDWICH:
             product_type = PRODUCT_SANDWICH;
-            // Consume ingredients for sandwich
-            inventory->quantities[ITEM_CHEESE_SALAMI] -= 2;
-            // Note: bread consumption is handled by marking it as "sold" in the chef_process function
             break;
-            
         case CHEF_SWEET:
             product_type = PRODUCT_SWEET;
-            // Consume ingredients for sweet
-            inventory->quantities[ITEM_SUGAR_SALT] -= 2;
-            inventory->quantities[ITEM_SWEET_ITEMS] -= 3;
             break;
-            
         case CHEF_SWEET_PATISSERIE:
             product_type = PRODUCT_SWEET_PATISSERIE;
-            // Consume ingredients for sweet patisserie
-            inventory->quantities[ITEM_SWEET_ITEMS] -= 2;
-            inventory->quantities[ITEM_SUGAR_SALT] -= 1;
-            
-            // Mark paste as consumed
-            status->sold_items[PRODUCT_PASTE]++;
             break;
-            
         case CHEF_SAVORY_PATISSERIE:
             product_type = PRODUCT_SAVORY_PATISSERIE;
-            // Consume ingredients for savory patisserie
-            inventory->quantities[ITEM_CHEESE_SALAMI] -= 1;
-            inventory->quantities[ITEM_BUTTER] -= 1;
-            
-            // Mark paste as consumed
-            status->sold_items[PRODUCT_PASTE]++;
             break;
-            
         default:
             fprintf(stderr, "Unknown chef type: %d\n", type);
             return;
     }
     
+    // Consume the raw materials of the recipe
+    seqlock_write_begin(stats_seqlock(STATS_SEQ_INVENTORY));
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        inventory->quantities[i] -= recipes[type][i];
+    }
+    seqlock_write_end(stats_seqlock(STATS_SEQ_INVENTORY));
+    
+    // Consume the reserved paste or bread (counted as sold, like any other consumption)
+    WipItem wip_input;
+    bool uses_wip = recipe_wip_input(type, &wip_input);
+    
+    if (uses_wip) {
+        wip_commit(&status->wip, wip_input, 1);
+    }
+    
+    seqlock_write_begin(stats_seqlock(STATS_SEQ_STATUS));
+    
+    if (uses_wip) {
+        counter_add(&status->sold_items[wip_input == WIP_PASTE ? PRODUCT_PASTE : PRODUCT_BREAD], 1);
+    }
+    
     // Increment produced items counter
-    status->produced_items[product_type]++;
+    counter_add(&status->produced_items[product_type], 1);
+    
+    seqlock_write_end(stats_seqlock(STATS_SEQ_STATUS));
+    
+    // Paste becomes available to the patisserie chefs right away
+    if (product_type == PRODUCT_PASTE) {
+        wip_deposit(&status->wip, WIP_PASTE, 1);
+    }
 }
 
 // Chef process main function
 void chef_process(ChefType type, int id, int inventory_shm_id, int prod_status_shm_id,
-                 int inventory_sem_id, int prod_sem_id, BakeryConfig config) {
+                 BakeryConfig config) {
     
     // Attach to shared memory segments
-    Inventory *inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    Inventory *inventory = (Inventory *) shm_region_attach(inventory_shm_id);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (inventory == (void *) -1 || status == (void *) -1) {
+    if (inventory == NULL || status == NULL) {
         perror("Chef: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Define semaphore operations
-    struct sembuf inventory_lock = {0, -1, 0};
-    struct sembuf inventory_unlock = {0, 1, 0};
-    struct sembuf prod_lock = {0, -1, 0};
-    struct sembuf prod_unlock = {0, 1, 0};
+    // Raw materials this chef reserves on every round
+    int ingredients[ITEM_RAW_MATERIAL_COUNT];
+    int num_ingredients = recipe_ingredients(type, ingredients);
+    
+    // Paste or bread this chef needs, if any
+    WipItem wip_input;
+    bool uses_wip = recipe_wip_input(type, &wip_input);
+    
+    // Chefs are numbered across all teams for their statistics shard
+    int chef_index = id;
+    for (int t = 0; t < type; t++) {
+        chef_index += config.num_chefs[t];
+    }
+    stats_bind_worker(ROLE_CHEF, chef_index);
     
     printf("Chef %d of type %d started (PID: %d)\n", id, type, getpid());
     
@@ -201,66 +233,63 @@ void chef_process(ChefType type, int id, int inventory_shm_id, int prod_status_s
                 continue;
         }
         
-        // Lock inventory to check ingredients
-        if (semop(inventory_sem_id, &inventory_lock, 1) == -1) {
-            perror("Chef: Failed to lock inventory semaphore");
-            sleep(1);
-            continue;
-        }
-        
-        // Check if we have necessary ingredients
-        bool ingredients_available = check_dependencies(type, inventory);
-        
-        if (!ingredients_available) {
-            // Not enough ingredients, unlock inventory and wait
-            if (semop(inventory_sem_id, &inventory_unlock, 1) == -1) {
-                perror("Chef: Failed to unlock inventory semaphore");
+        // Reserve paste or bread first; the ledger hands each unit to exactly one chef
+        if (uses_wip) {
+            WakeupChannel *ready = &status->wip.entries[wip_input].ready;
+            unsigned int seen = wakeup_prepare(ready);
+            
+            if (!wip_reserve(&status->wip, wip_input, 1)) {
+                // Nothing to work with yet, wait for the next deposit
+                wait_for_supplies(ready, seen, WIP_WAIT_SECONDS, config);
+                continue;
             }
-            sleep(3);
-            continue;
         }
         
-        // Lock production status to check pastry dependencies if needed
-        if ((type == CHEF_SWEET_PATISSERIE || type == CHEF_SAVORY_PATISSERIE) && 
-            (semop(prod_sem_id, &prod_lock, 1) == -1)) {
-            perror("Chef: Failed to lock production status semaphore");
+        // Reserve exactly the ingredients of our recipe in one atomic step,
+        // failing fast if another chef or supplier is holding one of them
+        if (bakery_lock_try_acquire_set(inventory->item_locks, ingredients, num_ingredients) == -1) {
+            if (uses_wip) {
+                wip_abort(&status->wip, wip_input, 1);
+            }
             
-            // Unlock inventory
-            if (semop(inventory_sem_id, &inventory_unlock, 1) == -1) {
-                perror("Chef: Failed to unlock inventory semaphore");
+            if (errno != EAGAIN) {
+                perror("Chef: Failed to lock inventory semaphores");
+                sleep(1);
+            } else {
+                usleep(INGREDIENT_RETRY_DELAY_US);
             }
-            sleep(1);
             continue;
         }
         
-        // For patisserie, check if there's available paste
-        bool can_proceed = true;
-        if (type == CHEF_SWEET_PATISSERIE || type == CHEF_SAVORY_PATISSERIE) {
-            if (status->produced_items[PRODUCT_PASTE] - status->sold_items[PRODUCT_PASTE] <= 0) {
-                can_proceed = false;
-            }
+        // Check if we have necessary ingredients
+        int missing = missing_ingredient(type, inventory);
+        bool ingredients_available = (missing == -1);
+        unsigned int restock_seen = 0;
+        
+        if (ingredients_available) {
+            // We have all required ingredients, proceed to produce the item
+            produce_item(type, inventory, status, config);
+            counter_add(&stats_local()->items_handled, 1);
+        } else {
+            // Read the restock generation while we still hold the item lock,
+            // so a restock that lands before we go to sleep is not missed
+            restock_seen = wakeup_prepare(&inventory->restocked[missing]);
             
-            // Unlock production status
-            if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
-                perror("Chef: Failed to unlock production status semaphore");
+            if (uses_wip) {
+                // Hand the paste or bread back for another chef
+                wip_abort(&status->wip, wip_input, 1);
             }
         }
         
-        if (!can_proceed) {
-            // Not enough paste, unlock inventory and wait
-            if (semop(inventory_sem_id, &inventory_unlock, 1) == -1) {
-                perror("Chef: Failed to unlock inventory semaphore");
-            }
-            sleep(2);
-            continue;
+        // Unlock our ingredients
+        if (bakery_lock_release_set(inventory->item_locks, ingredients, num_ingredients) == -1) {
+            perror("Chef: Failed to unlock inventory semaphores");
         }
         
-        // We have all required ingredients, proceed to produce the item
-        produce_item(type, inventory, status, config);
-        
-        // Unlock inventory
-        if (semop(inventory_sem_id, &inventory_unlock, 1) == -1) {
-            perror("Chef: Failed to unlock inventory semaphore");
+        if (!ingredients_available) {
+            // Not enough ingredients, wait for the supply chain to restock what we lack
+            wait_for_supplies(&inventory->restocked[missing], restock_seen,
+                              INGREDIENT_WAIT_SECONDS, config);
             continue;
         }
         
@@ -275,8 +304,8 @@ void chef_process(ChefType type, int id, int inventory_shm_id, int prod_status_s
     printf("Chef %d of type %d terminating (PID: %d)\n", id, type, getpid());
     
     // Detach from shared memory
-    shmdt(inventory);
-    shmdt(status);
+    shm_region_detach(inventory_shm_id, inventory);
+    shm_region_detach(prod_status_shm_id, status);
 }
 
 // Reallocate chefs between teams (called by management)
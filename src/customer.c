@@ -1,201 +1,483 @@
 #include "../include/customer.h"
+#include "../include/counters.h"
+#include "../include/stats.h"
+#include "../include/order_transport.h"
+#include "../include/mailbox.h"
+#include "../include/order_wire.h"
+#include "../include/customer_engine.h"
+#include "../include/customer_pool.h"
+#include "../include/arrivals.h"
+#include "../include/popularity.h"
+#include "../include/arrival_trace.h"
+#include "../include/histogram.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
 #include <unistd.h>
 #include <time.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <sys/msg.h>
+#include <sys/wait.h>
+
+// How often the response timer fires again after the deadline, in case the first
+// SIGALRM arrived just before msgrcv started blocking
+#define RESPONSE_TIMER_REFIRE_US 10000  // 10ms
+
+// SIGALRM handler: its only job is to interrupt a blocking msgrcv (installed without
+// SA_RESTART), after which the waiting loop checks its deadline
+void handle_timeout(int sig) {
+    (void) sig;
+}
+
+// Microseconds from now until deadline on the monotonic clock (negative once it passed)
+static long long usec_until(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (long long) (deadline->tv_sec - now.tv_sec) * 1000000LL +
+           (deadline->tv_nsec - now.tv_nsec) / 1000;
+}
+
+// Block until the response to request arrives or the deadline passes; false on timeout
+static bool wait_for_response(int msg_queue_id, CustomerMsg *request, CustomerMsg *response,
+                              const struct timespec *deadline) {
+    while (1) {
+        long long remaining = usec_until(deadline);
+        if (remaining <= 0) {
+            return false;
+        }
+        
+        struct itimerval timer = {
+            .it_interval = {0, RESPONSE_TIMER_REFIRE_US},
+            .it_value = {remaining / 1000000, remaining % 1000000}
+        };
+        setitimer(ITIMER_REAL, &timer, NULL);
+        
+        int rc = order_wire_receive(msg_queue_id, response,
+                                    request->customer_id + MSG_CUSTOMER_RESPONSE_BASE, 0);
+        int saved_errno = errno;
+        
+        struct itimerval disarm = {{0, 0}, {0, 0}};
+        setitimer(ITIMER_REAL, &disarm, NULL);
+        
+        if (rc == 0) {
+            // Only the response to this exact order counts; anything else is stale
+            if (response->request_id == request->request_id) {
+                return true;
+            }
+            continue;
+        }
+        
+        if (saved_errno != EINTR && saved_errno != EBADMSG) {
+            errno = saved_errno;
+            perror("Customer: Failed to receive response");
+            return false;
+        }
+    }
+}
+
+// Fill msg with a new random basket order for customer_id (no reply route or deadline yet)
+void generate_customer_request(CustomerMsg *msg, int customer_id, BakeryConfig config) {
+    int num_items = 1 + rand() % config.max_purchase_items;
+    
+    msg->msg_type = MSG_CUSTOMER_REQUEST;
+    msg->customer_id = customer_id;
+    msg->order_class = ((double)rand() / RAND_MAX < config.vip_probability)
+                       ? ORDER_CLASS_VIP : ORDER_CLASS_REGULAR;
+    msg->fulfilled = false;
+    msg->num_lines = num_items;
+    msg->reply_slot = -1;
+    msg->reply_seq = 0;
+    
+    // Fill the basket
+    for (int i = 0; i < num_items; i++) {
+        BasketLine *line = &msg->lines[i];
+        
+        // Pick a product and its subtype (flavor, variety) by popularity
+        line->product_type = popularity_pick_product();
+        line->subtype = popularity_pick_subtype(line->product_type);
+        
+        // Request 1-3 of the item
+        line->quantity = 1 + rand() % 3;
+        line->fulfilled = false;
+        
+        printf("Customer %d wants %d of product %d (subtype %d)\n", 
+               customer_id, line->quantity, line->product_type, line->subtype);
+    }
+}
+
+// Decide everything about an arriving customer: patience and basket
+void generate_customer_arrival(CustomerArrival *arrival, int customer_id, BakeryConfig config) {
+    arrival->customer_id = customer_id;
+    arrival->patience = config.customer_params[2] +
+                        rand() % (config.customer_params[3] - config.customer_params[2] + 1);
+    
+    generate_customer_request(&arrival->request, customer_id, config);
+}
+
+// Report which lines of a response were fulfilled; returns an unfulfilled line, or -1 if none
+int check_customer_response(const CustomerMsg *response) {
+    int unfulfilled_line = -1;
+    
+    for (int i = 0; i < response->num_lines && i < MAX_BASKET_LINES; i++) {
+        const BasketLine *line = &response->lines[i];
+        
+        if (line->fulfilled) {
+            printf("Customer %d received %d of product %d (subtype %d)\n",
+                   response->customer_id, line->quantity, line->product_type, line->subtype);
+        } else {
+            printf("Customer %d could not get product %d (subtype %d)\n",
+                   response->customer_id, line->product_type, line->subtype);
+            unfulfilled_line = i;
+        }
+    }
+    
+    return unfulfilled_line;
+}
+
+// Count a frustrated customer (unfulfilled_line >= 0) and decide whether it complains;
+// if so, request is turned into the complaint about that line and true is returned
+bool prepare_complaint(CustomerMsg *request, int unfulfilled_line, BakeryConfig config) {
+    // Only mark customer as frustrated if not all requests were fulfilled
+    if (unfulfilled_line < 0) {
+        return false;
+    }
+    
+    counter_add(&stats_local()->frustrated_customers, 1);
+    
+    // Decide if customer complains
+    if ((double)rand() / RAND_MAX >= config.complaint_probability) {
+        return false;
+    }
+    
+    request->order_class = ORDER_CLASS_COMPLAINT;
+    request->msg_type = MSG_CUSTOMER_REQUEST;
+    request->request_id = order_new_request_id();
+    request->deadline_ns = 0;  // Complaints are handled even after the customer left
+    request->lines[0] = request->lines[unfulfilled_line];
+    request->num_lines = 1;
+    return true;
+}
+
+// Count a frustrated customer (unfulfilled_line >= 0) and maybe complain about that line
+void finish_customer_visit(CustomerMsg *request, int unfulfilled_line, BakeryConfig config) {
+    if (!prepare_complaint(request, unfulfilled_line, config)) {
+        return;
+    }
+    
+    // Send the complaint message
+    if (order_send(request) == -1) {
+        perror("Customer: Failed to send complaint message");
+    } else {
+        printf("Customer %d filed a complaint\n", request->customer_id);
+    }
+}
+
+// Fork the customer pool's worker processes; returns their pids (NULL on failure)
+static pid_t *start_customer_workers(int msg_queue_id, int prod_status_shm_id, BakeryConfig config) {
+    int num_workers = customer_pool_size();
+    pid_t *pids = calloc(num_workers, sizeof(pid_t));
+    if (pids == NULL) {
+        return NULL;
+    }
+    
+    for (int i = 0; i < num_workers; i++) {
+        pids[i] = fork();
+        
+        if (pids[i] == -1) {
+            perror("Failed to fork customer worker");
+            free(pids);
+            return NULL;
+        } else if (pids[i] == 0) {
+            // Child process (customer worker)
+            customer_worker_process(i, msg_queue_id, prod_status_shm_id, config);
+            exit(EXIT_SUCCESS);
+        }
+    }
+    
+    customer_pool_started();
+    printf("Started %d customer workers\n", num_workers);
+    return pids;
+}
+
+// Collect customer processes that have left, so they do not linger as zombies
+static void reap_customers(void) {
+    while (waitpid(-1, NULL, WNOHANG) > 0) {
+        // Keep going until no exited child is left
+    }
+}
 
 // Customer generator process
 void customer_generator(int msg_queue_id, int prod_status_shm_id, 
-                      int prod_sem_id, BakeryConfig config) {
+                      BakeryConfig config) {
     
     // Attach to shared memory
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (status == (void *) -1) {
+    if (status == NULL) {
         perror("Customer Generator: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
     printf("Customer generator process started (PID: %d)\n", getpid());
     
+    // With CUSTOMER_ENGINE=threads customers are state machines in this process
+    bool use_engine = customer_engine_enabled();
+    if (use_engine && customer_engine_start(config) == -1) {
+        perror("Customer Generator: Failed to start customer engine");
+        exit(EXIT_FAILURE);
+    }
+    
+    // With CUSTOMER_ENGINE=pool a fixed set of workers takes the arrivals
+    pid_t *worker_pids = NULL;
+    if (customer_pool_enabled()) {
+        worker_pids = start_customer_workers(msg_queue_id, prod_status_shm_id, config);
+        if (worker_pids == NULL) {
+            perror("Customer Generator: Failed to start customer workers");
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Customers arrive open loop, on a schedule fixed in advance (or as recorded in a trace)
+    ArrivalSchedule schedule;
+    arrival_schedule_init(&schedule, config);
+    bool replaying = arrival_trace_replaying();
+    
     // Customer process counter
     int customer_id = 0;
     
     // Main loop
-    while (status->simulation_active) {
+    while (1) {
+        CustomerArrival arrival;
+        
+        if (replaying) {
+            uint64_t offset_ns;
+            
+            if (arrival_trace_next(&arrival, &offset_ns) == -1) {
+                if (errno != ENODATA) {
+                    perror("Failed to read the arrival trace");
+                }
+                break;
+            }
+            arrival_schedule_at(&schedule, offset_ns);
+        }
+        
+        if (!arrival_wait(&schedule, status)) {
+            break;
+        }
+        
         // Generate a new customer
-        pid_t pid = fork();
+        if (!replaying) {
+            generate_customer_arrival(&arrival, customer_id, config);
+        }
         
-        if (pid == -1) {
-            perror("Failed to fork customer process");
+        if (arrival_trace_record(&arrival, schedule.due_ns - schedule.start_ns) == -1) {
+            perror("Failed to record the arrival trace");
             break;
-        } else if (pid == 0) {
-            // Child process (customer)
-            customer_process(customer_id, msg_queue_id, prod_status_shm_id, prod_sem_id, config);
-            exit(EXIT_SUCCESS);  // Should not reach here
+        }
+        
+        if (use_engine) {
+            if (customer_engine_admit(&arrival) == -1) {
+                perror("Failed to admit customer to the engine");
+                break;
+            }
+        } else if (worker_pids != NULL) {
+            if (customer_pool_submit(&arrival, status) == -1) {
+                // ECANCELED: the simulation ended while the pool was full
+                if (errno != ECANCELED) {
+                    perror("Failed to hand customer to the pool");
+                }
+                break;
+            }
         } else {
-            // Parent process (customer generator)
-            printf("Generated customer %d with PID %d\n", customer_id, pid);
-            customer_id++;
+            reap_customers();
             
-            // Wait a shorter random amount of time before generating the next customer
-            // Using shorter wait times to generate more customers during the simulation
-            int wait_time = 1 + rand() % 3;  // 1-3 seconds between customers instead of using config params
+            pid_t pid = fork();
             
-            sleep(wait_time);
-            
-            // Generate multiple waves of customers
-            if (customer_id >= 10) {
-                // After generating 10 customers, wait a bit
-                sleep(5);
-                // Continue generating more customers
+            if (pid == -1) {
+                perror("Failed to fork customer process");
+                break;
+            } else if (pid == 0) {
+                // Child process (customer)
+                customer_process(&arrival, msg_queue_id, prod_status_shm_id, config);
+                exit(EXIT_SUCCESS);  // Should not reach here
             }
+            
+            printf("Generated customer %d with PID %d\n", arrival.customer_id, pid);
         }
+        customer_id++;
+    }
+    
+    arrival_trace_finish();
+    
+    // A replayed trace can run out before the simulation ends; let its customers finish
+    while (replaying && status->simulation_active) {
+        sleep(1);
+    }
+    
+    if (use_engine) {
+        customer_engine_stop();
+    }
+    
+    // Workers leave once they see the simulation end and finish their current visit
+    if (worker_pids != NULL) {
+        for (int i = 0; i < customer_pool_size(); i++) {
+            waitpid(worker_pids[i], NULL, 0);
+        }
+        free(worker_pids);
     }
     
     printf("Customer generator process terminating (PID: %d)\n", getpid());
     
     // Detach from shared memory
-    shmdt(status);
+    shm_region_detach(prod_status_shm_id, status);
 }
 
-// Individual customer process
-void customer_process(int id, int msg_queue_id, int prod_status_shm_id, int prod_sem_id, BakeryConfig config) {
-    // Attach to shared memory
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
-    
-    if (status == (void *) -1) {
-        perror("Customer: Failed to attach to shared memory");
-        exit(EXIT_FAILURE);
-    }
-    
-    // Configure customer patience (how long they'll wait for service)
-    int patience = config.customer_params[2] + 
-                  rand() % (config.customer_params[3] - config.customer_params[2] + 1);
+// One visit: order a basket, wait for it until patience runs out, maybe complain
+static void visit_bakery(const CustomerArrival *arrival, int msg_queue_id, BakeryConfig config) {
+    // The generator already fixed patience (how long they'll wait for service) and basket
+    int id = arrival->customer_id;
+    int patience = arrival->patience;
     
     printf("Customer %d arrived with patience %d seconds (PID: %d)\n", id, patience, getpid());
     
-    // Decide what products to request
-    int num_items = 1 + rand() % config.max_purchase_items;
-    CustomerMsg request_msg;
+    CustomerMsg request_msg = arrival->request;
+    int num_items = request_msg.num_lines;
     
-    request_msg.msg_type = MSG_CUSTOMER_REQUEST;
-    request_msg.customer_id = id;
-    request_msg.is_complaint = false;
+    // With RESPONSE_TRANSPORT=mailbox, take a private mailbox for the response
+    // (-1 falls back to the message queue, also when every mailbox is in use)
+    request_msg.reply_slot = mailbox_claim(id);
     
     // Keep track of whether all requests were fulfilled
     bool all_requests_fulfilled = true;
     
-    // Send the request to a seller
-    for (int i = 0; i < num_items; i++) {
-        // Pick a random product
-        request_msg.product_type = rand() % PRODUCT_TYPE_COUNT;
-        
-        // Select a subtype (flavor, variety) if applicable
-        if (request_msg.product_type < PRODUCT_TYPE_COUNT && 
-            config.num_categories[request_msg.product_type] > 0) {
-            request_msg.subtype = rand() % config.num_categories[request_msg.product_type];
-        } else {
-            request_msg.subtype = 0;
-        }
-        
-        // Request 1-3 of the item
-        request_msg.quantity = 1 + rand() % 3;
-        
-        // Send the request to the message queue
-        if (msgsnd(msg_queue_id, &request_msg, sizeof(request_msg) - sizeof(long), 0) == -1) {
-            perror("Customer: Failed to send message to queue");
-            all_requests_fulfilled = false;
-            break;
-        }
-        
-        printf("Customer %d requested %d of product %d (subtype %d)\n", 
-               id, request_msg.quantity, request_msg.product_type, request_msg.subtype);
+    // One line that was not fulfilled, named in a complaint
+    int unfulfilled_line = -1;
+    
+    if (request_msg.reply_slot >= 0) {
+        request_msg.reply_seq = mailbox_expect(request_msg.reply_slot);
+    }
+    
+    // Wait for the response until patience runs out (measured on the monotonic clock);
+    // the order carries the same deadline so sellers can skip it once we are gone
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += patience;
+    
+    request_msg.request_id = order_new_request_id();
+    request_msg.deadline_ns = (uint64_t) deadline.tv_sec * 1000000000ULL + deadline.tv_nsec;
+    
+    // Send the whole basket to the sellers in one order
+    if (order_send(&request_msg) == -1) {
+        perror("Customer: Failed to send message to queue");
+        all_requests_fulfilled = false;
+        unfulfilled_line = 0;
+    } else {
+        printf("Customer %d ordered a basket of %d items%s\n", id, num_items,
+               request_msg.order_class == ORDER_CLASS_VIP ? " (VIP)" : "");
         
-        // Wait for response with timeout based on patience
         CustomerMsg response_msg;
-        time_t start_time = time(NULL);
-        bool got_response = false;
         
-        while ((time(NULL) - start_time) < patience) {
-            ssize_t recv_size = msgrcv(msg_queue_id, &response_msg, sizeof(CustomerMsg) - sizeof(long),
-                                     id + MSG_CUSTOMER_RESPONSE_BASE, IPC_NOWAIT);
-            
-            if (recv_size != -1) {
-                // Got a response for this specific request
-                if (response_msg.product_type == request_msg.product_type &&
-                    response_msg.subtype == request_msg.subtype) {
-                    
-                    got_response = true;
-                    
-                    // Check if the request was fulfilled
-                    if (response_msg.fulfilled) {
-                        printf("Customer %d received %d of product %d (subtype %d)\n",
-                               id, request_msg.quantity, request_msg.product_type, request_msg.subtype);
-                    } else {
-                        printf("Customer %d could not get product %d (subtype %d)\n",
-                               id, request_msg.product_type, request_msg.subtype);
-                        all_requests_fulfilled = false;
-                    }
-                    break;
-                }
-            }
-            
-            // Wait a bit before checking again
-            usleep(100000);  // 100ms
+        bool got_response;
+        if (request_msg.reply_slot >= 0) {
+            got_response = mailbox_wait(request_msg.reply_slot, request_msg.reply_seq,
+                                        &response_msg, &deadline) == 0 &&
+                           response_msg.request_id == request_msg.request_id;
+        } else {
+            got_response = wait_for_response(msg_queue_id, &request_msg, &response_msg, &deadline);
         }
         
-        if (!got_response) {
-            printf("Customer %d timed out waiting for product %d\n", 
-                   id, request_msg.product_type);
+        if (got_response) {
+            unfulfilled_line = check_customer_response(&response_msg);
+            all_requests_fulfilled = unfulfilled_line == -1;
+        } else {
+            printf("Customer %d timed out waiting for a basket of %d items\n", id, num_items);
             all_requests_fulfilled = false;
+            unfulfilled_line = 0;
         }
-        
-        // Wait a short time between different item requests
-        usleep(500000);  // 0.5 seconds
     }
     
-    // Lock production status to update statistics
-    struct sembuf prod_lock = {0, -1, 0};
-    struct sembuf prod_unlock = {0, 1, 0};
+    finish_customer_visit(&request_msg, unfulfilled_line, config);
+    
+    printf("Customer %d leaving %s (PID: %d)\n", 
+           id, all_requests_fulfilled ? "satisfied" : "frustrated", getpid());
+    
+    mailbox_release(request_msg.reply_slot);
+}
+
+// SIGALRM ends a blocking wait for a response when patience runs out
+static void install_timeout_handler(void) {
+    struct sigaction timeout_action;
+    timeout_action.sa_handler = handle_timeout;
+    sigemptyset(&timeout_action.sa_mask);
+    timeout_action.sa_flags = 0;  // No SA_RESTART, msgrcv must return EINTR
+    sigaction(SIGALRM, &timeout_action, NULL);
+}
+
+// Individual customer process
+void customer_process(const CustomerArrival *arrival, int msg_queue_id, int prod_status_shm_id,
+                      BakeryConfig config) {
+    // Attach to shared memory
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (semop(prod_sem_id, &prod_lock, 1) == -1) {
-        perror("Customer: Failed to lock production status semaphore");
-        shmdt(status);
+    if (status == NULL) {
+        perror("Customer: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Only mark customer as frustrated if not all requests were fulfilled
-    if (!all_requests_fulfilled) {
-        status->frustrated_customers++;
-        
-        // Decide if customer complains
-        if ((double)rand() / RAND_MAX < config.complaint_probability) {
-            // Send a complaint message
-            request_msg.is_complaint = true;
-            request_msg.msg_type = MSG_CUSTOMER_REQUEST;
-            
-            if (msgsnd(msg_queue_id, &request_msg, sizeof(request_msg) - sizeof(long), 0) == -1) {
-                perror("Customer: Failed to send complaint message");
-            } else {
-                printf("Customer %d filed a complaint\n", id);
-            }
-        }
+    // Customers share a few statistics shards, picked by id
+    stats_bind_worker(ROLE_CUSTOMER, arrival->customer_id);
+    install_timeout_handler();
+    
+    visit_bakery(arrival, msg_queue_id, config);
+    
+    // Detach from shared memory
+    shm_region_detach(prod_status_shm_id, status);
+}
+
+// Pool worker process: run visits for arrivals from the pool until the simulation ends
+void customer_worker_process(int index, int msg_queue_id, int prod_status_shm_id,
+                             BakeryConfig config) {
+    // Attach to shared memory
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
+    
+    if (status == NULL) {
+        perror("Customer worker: Failed to attach to shared memory");
+        exit(EXIT_FAILURE);
     }
     
-    // Unlock production status
-    if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
-        perror("Customer: Failed to unlock production status semaphore");
+    // Every worker starts from the generator's random state; make their complaints differ
+    srand(time(NULL) ^ getpid());
+    
+    customer_pool_bind_worker(index);
+    install_timeout_handler();
+    
+    printf("Customer worker %d started (PID: %d)\n", index, getpid());
+    
+    while (status->simulation_active) {
+        CustomerArrival arrival;
+        
+        if (customer_pool_take(&arrival) == -1) {
+            if (errno == ETIMEDOUT || errno == EINTR) {
+                continue;
+            }
+            perror("Customer worker: Failed to take an arrival");
+            break;
+        }
+        
+        uint64_t start_ns = histogram_now_ns();
+        stats_bind_worker(ROLE_CUSTOMER, arrival.customer_id);
+        visit_bakery(&arrival, msg_queue_id, config);
+        customer_pool_record_session(histogram_now_ns() - start_ns);
     }
     
-    printf("Customer %d leaving %s (PID: %d)\n", 
-           id, all_requests_fulfilled ? "satisfied" : "frustrated", getpid());
+    printf("Customer worker %d terminating (PID: %d)\n", index, getpid());
     
     // Detach from shared memory
-    shmdt(status);
+    shm_region_detach(prod_status_shm_id, status);
 }
\ No newline at end of file
@@ -0,0 +1,660 @@
+#include "../include/customer_engine.h"
+#include "../include/customer.h"
+#include "../include/histogram.h"
+#include "../include/mailbox.h"
+#include "../include/order_transport.h"
+#include "../include/stats.h"
+#include "../include/wakeup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Longest a worker sleeps with no deadline due (customer_engine_stop wakes it anyway)
+#define ENGINE_IDLE_WAIT_MS 1000
+
+// How soon a worker retries sends the full order channel refused
+#define ENGINE_RETRY_WAIT_MS 10
+
+// A customer waiting for its response
+typedef struct {
+    CustomerMsg order;     // As sent; reply_slot and reply_seq name the mailbox
+    unsigned int serial;   // Bumped when the entry is freed, so stale timers are ignored
+    bool waiting;
+    int next_free;
+} EngineCustomer;
+
+// Deadline of a waiting customer
+typedef struct {
+    uint64_t deadline_ns;
+    int customer;
+    unsigned int serial;
+} EngineTimer;
+
+// An order or complaint waiting for room in the order channel
+typedef struct {
+    CustomerMsg msg;
+    int customer;          // Customer entry of an order; -1 for a complaint
+    unsigned int serial;   // Entry serial when queued; the order is dropped once the customer left
+} EngineSend;
+
+// Private state of one worker thread (the index is also its mailbox group)
+typedef struct {
+    int index;
+    pthread_t thread;
+    CustomerEngineWorker *stats;
+
+    // New arrivals, handed over by customer_engine_admit
+    pthread_mutex_t inbox_lock;
+    CustomerArrival *inbox;
+    int inbox_count;
+    int inbox_capacity;
+    CustomerArrival *arrivals;  // Swapped with inbox to start the visits outside the lock
+    int arrivals_capacity;
+
+    EngineCustomer *customers;
+    int num_customers;     // Entries in use or on the free list
+    int customers_capacity;
+    int free_head;         // -1 if the free list is empty
+
+    EngineTimer *timers;   // Min-heap on deadline_ns
+    int num_timers;
+    int timers_capacity;
+
+    EngineSend *sends;     // Retried every pass, oldest first
+    int num_sends;
+    int sends_capacity;
+} EngineWorker;
+
+// Created by the parent before forking, so management inherits the mapping
+static CustomerEngineBoard *engine_board = NULL;
+static int engine_board_shm_id = -1;
+
+// Only used inside the customer generator process
+static EngineWorker *engine_workers = NULL;
+static int engine_num_workers = 0;
+static int engine_started = 0;       // Workers whose thread is running
+static int *slot_customer = NULL;    // Mailbox slot -> customer entry of the worker owning the slot
+static _Atomic bool engine_stopping = false;
+static unsigned int next_worker = 0;
+static BakeryConfig engine_config;
+
+// Make room for at least one more element in a growable array; -1 if out of memory
+static int reserve_one(void **array, int count, int *capacity, size_t element_size) {
+    if (count < *capacity) {
+        return 0;
+    }
+
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+    void *grown = realloc(*array, (size_t) new_capacity * element_size);
+    if (grown == NULL) {
+        return -1;
+    }
+
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+// Record a statistic only this worker writes
+static void add_stat(_Atomic unsigned long *counter) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+static void swap_timers(EngineWorker *worker, int i, int j) {
+    EngineTimer tmp = worker->timers[i];
+    worker->timers[i] = worker->timers[j];
+    worker->timers[j] = tmp;
+}
+
+// Add a deadline to the worker's timer heap
+static int push_timer(EngineWorker *worker, uint64_t deadline_ns, int customer) {
+    if (reserve_one((void **) &worker->timers, worker->num_timers, &worker->timers_capacity,
+                    sizeof(EngineTimer)) == -1) {
+        return -1;
+    }
+
+    int i = worker->num_timers++;
+    worker->timers[i].deadline_ns = deadline_ns;
+    worker->timers[i].customer = customer;
+    worker->timers[i].serial = worker->customers[customer].serial;
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (worker->timers[parent].deadline_ns <= worker->timers[i].deadline_ns) {
+            break;
+        }
+        swap_timers(worker, i, parent);
+        i = parent;
+    }
+    return 0;
+}
+
+// Remove the earliest deadline from the timer heap
+static EngineTimer pop_timer(EngineWorker *worker) {
+    EngineTimer first = worker->timers[0];
+    int i = 0;
+
+    worker->timers[0] = worker->timers[--worker->num_timers];
+    while (1) {
+        int earliest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < worker->num_timers &&
+            worker->timers[left].deadline_ns < worker->timers[earliest].deadline_ns) {
+            earliest = left;
+        }
+        if (right < worker->num_timers &&
+            worker->timers[right].deadline_ns < worker->timers[earliest].deadline_ns) {
+            earliest = right;
+        }
+        if (earliest == i) {
+            break;
+        }
+        swap_timers(worker, i, earliest);
+        i = earliest;
+    }
+    return first;
+}
+
+// Take a free customer entry; -1 if out of memory
+static int alloc_customer(EngineWorker *worker) {
+    if (worker->free_head != -1) {
+        int customer = worker->free_head;
+        worker->free_head = worker->customers[customer].next_free;
+        return customer;
+    }
+
+    if (reserve_one((void **) &worker->customers, worker->num_customers,
+                    &worker->customers_capacity, sizeof(EngineCustomer)) == -1) {
+        return -1;
+    }
+
+    int customer = worker->num_customers++;
+    worker->customers[customer].serial = 0;
+    worker->customers[customer].waiting = false;
+    return customer;
+}
+
+static void free_customer(EngineWorker *worker, int customer) {
+    EngineCustomer *entry = &worker->customers[customer];
+
+    entry->waiting = false;
+    entry->serial++;
+    entry->next_free = worker->free_head;
+    worker->free_head = customer;
+}
+
+// Queue a message the order channel had no room for; -1 if out of memory
+static int defer_send(EngineWorker *worker, const CustomerMsg *msg, int customer) {
+    if (reserve_one((void **) &worker->sends, worker->num_sends, &worker->sends_capacity,
+                    sizeof(EngineSend)) == -1) {
+        return -1;
+    }
+
+    EngineSend *send = &worker->sends[worker->num_sends++];
+    send->msg = *msg;
+    send->customer = customer;
+    send->serial = customer != -1 ? worker->customers[customer].serial : 0;
+    add_stat(&worker->stats->deferred);
+    return 0;
+}
+
+// Send a complaint without blocking the worker, deferring it if the channel is full
+static void send_complaint(EngineWorker *worker, const CustomerMsg *complaint) {
+    if (order_try_send(complaint) == 0) {
+        printf("Customer %d filed a complaint\n", complaint->customer_id);
+    } else if (errno != EAGAIN || defer_send(worker, complaint, -1) == -1) {
+        perror("Customer: Failed to send complaint message");
+    }
+}
+
+// The customer leaves: count it, maybe complain, and give its mailbox back
+static void end_visit(EngineWorker *worker, int customer, int unfulfilled_line) {
+    EngineCustomer *entry = &worker->customers[customer];
+    int slot = entry->order.reply_slot;
+
+    if (prepare_complaint(&entry->order, unfulfilled_line, engine_config)) {
+        send_complaint(worker, &entry->order);
+    }
+    printf("Customer %d leaving %s (worker %d)\n", entry->order.customer_id,
+           unfulfilled_line < 0 ? "satisfied" : "frustrated", worker->index);
+
+    mailbox_release(slot);
+    atomic_fetch_sub_explicit(&worker->stats->waiting, 1, memory_order_relaxed);
+    free_customer(worker, customer);
+}
+
+// The customer leaves without having ordered; not a customer outcome
+static void leave_unserved(EngineWorker *worker, int customer) {
+    atomic_fetch_sub_explicit(&worker->stats->waiting, 1, memory_order_relaxed);
+    free_customer(worker, customer);
+}
+
+// Claim a mailbox in the worker's group for a customer; false if every mailbox is taken
+static bool claim_mailbox(EngineWorker *worker, int customer) {
+    CustomerMsg *order = &worker->customers[customer].order;
+
+    order->reply_slot = mailbox_claim_in_group(order->customer_id, worker->index);
+    if (order->reply_slot == -1) {
+        return false;
+    }
+
+    order->reply_seq = mailbox_expect(order->reply_slot);
+    slot_customer[order->reply_slot] = customer;
+    return true;
+}
+
+// A customer arrives: claim a mailbox, send its basket and start waiting for the response
+static void start_visit(EngineWorker *worker, const CustomerArrival *arrival) {
+    int customer = alloc_customer(worker);
+    if (customer == -1) {
+        perror("Customer engine: Failed to admit customer");
+        return;
+    }
+
+    EngineCustomer *entry = &worker->customers[customer];
+    CustomerMsg *order = &entry->order;
+    add_stat(&worker->stats->admitted);
+
+    int customer_id = arrival->customer_id;
+    int patience = arrival->patience;
+    printf("Customer %d arrived with patience %d seconds (worker %d)\n",
+           customer_id, patience, worker->index);
+
+    *order = arrival->request;
+    order->reply_slot = -1;
+
+    uint64_t deadline_ns = histogram_now_ns() + (uint64_t) patience * 1000000000ULL;
+    order->request_id = order_new_request_id();
+    order->deadline_ns = deadline_ns;
+    entry->waiting = true;
+
+    int waiting = atomic_fetch_add_explicit(&worker->stats->waiting, 1, memory_order_relaxed) + 1;
+    if (waiting > atomic_load_explicit(&worker->stats->max_waiting, memory_order_relaxed)) {
+        atomic_store_explicit(&worker->stats->max_waiting, waiting, memory_order_relaxed);
+    }
+
+    if (push_timer(worker, deadline_ns, customer) == -1) {
+        // Without a timer nobody would notice the deadline
+        perror("Customer engine: Failed to arm customer deadline");
+        leave_unserved(worker, customer);
+        return;
+    }
+
+    // Responses must come back through the worker's mailbox group. When every
+    // mailbox is taken the customer queues for one on the send list, and a full
+    // order channel must not stall the worker's other customers either: the order
+    // waits on the send list, while the customer's patience runs as usual
+    if (!claim_mailbox(worker, customer)) {
+        printf("Customer %d waits for a free mailbox\n", customer_id);
+    } else if (order_try_send(order) == 0) {
+        printf("Customer %d ordered a basket of %d items%s\n", customer_id, order->num_lines,
+               order->order_class == ORDER_CLASS_VIP ? " (VIP)" : "");
+        return;
+    } else if (errno != EAGAIN) {
+        perror("Customer: Failed to send message to queue");
+        if (mailbox_cancel(order->reply_slot, order->reply_seq)) {
+            end_visit(worker, customer, 0);
+        }
+        return;
+    }
+
+    if (defer_send(worker, order, customer) == -1) {
+        perror("Customer engine: Failed to queue customer order");
+        if (order->reply_slot == -1) {
+            leave_unserved(worker, customer);
+        } else if (mailbox_cancel(order->reply_slot, order->reply_seq)) {
+            end_visit(worker, customer, 0);
+        }
+    }
+}
+
+// Start the visits of customers handed over since the last round
+static void admit_arrivals(EngineWorker *worker) {
+    pthread_mutex_lock(&worker->inbox_lock);
+    int count = worker->inbox_count;
+    CustomerArrival *arrivals = worker->inbox;
+    int capacity = worker->inbox_capacity;
+
+    worker->inbox = worker->arrivals;
+    worker->inbox_capacity = worker->arrivals_capacity;
+    worker->inbox_count = 0;
+    pthread_mutex_unlock(&worker->inbox_lock);
+
+    worker->arrivals = arrivals;
+    worker->arrivals_capacity = capacity;
+    // Once the simulation ends, customers still queued up never come in
+    for (int i = 0; i < count && !atomic_load_explicit(&engine_stopping, memory_order_acquire); i++) {
+        start_visit(worker, &arrivals[i]);
+    }
+}
+
+// Retry the sends the order channel refused; orders of customers who left are dropped
+static void retry_sends(EngineWorker *worker) {
+    int count = worker->num_sends;  // Complaints deferred during this pass wait for the next one
+    int kept = 0;
+
+    for (int i = 0; i < count; i++) {
+        EngineSend send = worker->sends[i];  // A copy, end_visit may grow the list
+        EngineCustomer *entry = send.customer != -1 ? &worker->customers[send.customer] : NULL;
+
+        if (entry != NULL && (!entry->waiting || entry->serial != send.serial)) {
+            continue;
+        }
+
+        // Customers queued for a mailbox order once one is free
+        if (entry != NULL && entry->order.reply_slot == -1) {
+            if (!claim_mailbox(worker, send.customer)) {
+                worker->sends[kept++] = send;
+                continue;
+            }
+            send.msg = entry->order;
+        }
+
+        if (order_try_send(&send.msg) == 0) {
+            if (entry == NULL) {
+                printf("Customer %d filed a complaint\n", send.msg.customer_id);
+            } else {
+                printf("Customer %d ordered a basket of %d items%s\n", send.msg.customer_id,
+                       send.msg.num_lines,
+                       send.msg.order_class == ORDER_CLASS_VIP ? " (VIP)" : "");
+            }
+        } else if (errno == EAGAIN) {
+            worker->sends[kept++] = send;
+        } else if (entry == NULL) {
+            perror("Customer: Failed to send complaint message");
+        } else {
+            perror("Customer: Failed to send message to queue");
+            if (mailbox_cancel(send.msg.reply_slot, send.msg.reply_seq)) {
+                end_visit(worker, send.customer, 0);
+            }
+        }
+    }
+
+    int added = worker->num_sends - count;
+    memmove(&worker->sends[kept], &worker->sends[count], (size_t) added * sizeof(EngineSend));
+    worker->num_sends = kept + added;
+}
+
+// Finish the visits of customers whose response arrived
+static void collect_responses(EngineWorker *worker) {
+    int slot = mailbox_group_take(worker->index);
+
+    while (slot != -1) {
+        // The link is gone once the slot is released
+        int next = mailbox_group_next(slot);
+        int customer = slot_customer[slot];
+        EngineCustomer *entry = &worker->customers[customer];
+        CustomerMsg response;
+
+        if (entry->waiting && entry->order.reply_slot == slot &&
+            mailbox_take(slot, entry->order.reply_seq, &response) == 0 &&
+            response.request_id == entry->order.request_id) {
+            add_stat(&worker->stats->served);
+            end_visit(worker, customer, check_customer_response(&response));
+        }
+        slot = next;
+    }
+}
+
+// Let customers whose patience ran out leave; returns ms until the next deadline
+static int expire_visits(EngineWorker *worker) {
+    uint64_t now = histogram_now_ns();
+
+    while (worker->num_timers > 0 && worker->timers[0].deadline_ns <= now) {
+        EngineTimer timer = pop_timer(worker);
+        EngineCustomer *entry = &worker->customers[timer.customer];
+
+        if (!entry->waiting || entry->serial != timer.serial) {
+            continue;  // Already served
+        }
+
+        // Never got a mailbox, so never ordered: turned away, but not frustrated
+        if (entry->order.reply_slot == -1) {
+            printf("Customer %d left, no mailbox freed up in time\n", entry->order.customer_id);
+            add_stat(&worker->stats->turned_away);
+            leave_unserved(worker, timer.customer);
+            continue;
+        }
+
+        // If a seller is already delivering, the slot shows up on the ready list shortly
+        if (mailbox_cancel(entry->order.reply_slot, entry->order.reply_seq)) {
+            printf("Customer %d timed out waiting for a basket of %d items\n",
+                   entry->order.customer_id, entry->order.num_lines);
+            add_stat(&worker->stats->timed_out);
+            end_visit(worker, timer.customer, 0);
+        }
+    }
+
+    if (worker->num_timers == 0) {
+        return ENGINE_IDLE_WAIT_MS;
+    }
+
+    uint64_t wait_ms = (worker->timers[0].deadline_ns - now + 999999) / 1000000;
+    return wait_ms < ENGINE_IDLE_WAIT_MS ? (int) wait_ms : ENGINE_IDLE_WAIT_MS;
+}
+
+// Customers still waiting when the simulation ends just leave
+static void abandon_visits(EngineWorker *worker) {
+    for (int i = 0; i < worker->num_customers; i++) {
+        EngineCustomer *entry = &worker->customers[i];
+
+        if (entry->waiting) {
+            if (entry->order.reply_slot != -1) {
+                mailbox_cancel(entry->order.reply_slot, entry->order.reply_seq);
+                mailbox_release(entry->order.reply_slot);
+            }
+            leave_unserved(worker, i);
+        }
+    }
+}
+
+// Worker thread: one pass over arrivals, responses and deadlines per wakeup
+static void *engine_worker_main(void *arg) {
+    EngineWorker *worker = (EngineWorker *) arg;
+    WakeupChannel *channel = mailbox_group_channel(worker->index);
+
+    while (!atomic_load_explicit(&engine_stopping, memory_order_acquire)) {
+        // Arrivals and deliveries after this point bump the generation and cut the wait short
+        unsigned int seen = wakeup_prepare(channel);
+
+        admit_arrivals(worker);
+        retry_sends(worker);
+        collect_responses(worker);
+        int timeout_ms = expire_visits(worker);
+
+        // Sellers taking orders do not wake the worker; poll while sends are waiting
+        if (worker->num_sends > 0 && timeout_ms > ENGINE_RETRY_WAIT_MS) {
+            timeout_ms = ENGINE_RETRY_WAIT_MS;
+        }
+
+        if (wakeup_wait(channel, seen, timeout_ms) == -1 && errno != ETIMEDOUT && errno != EINTR) {
+            perror("Customer engine: Failed to wait for responses");
+        }
+    }
+
+    abandon_visits(worker);
+    return NULL;
+}
+
+// Create the shared engine counters if CUSTOMER_ENGINE=threads (called by the parent)
+int customer_engine_create(BakeryConfig config) {
+    if (config.customer_engine != CUSTOMER_ENGINE_THREADS) {
+        return 0;
+    }
+
+    int num_workers = config.customer_engine_threads;
+    if (num_workers < 1 || num_workers > MAILBOX_GROUPS) {
+        fprintf(stderr, "CUSTOMER_ENGINE_THREADS must be 1-%d\n", MAILBOX_GROUPS);
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t size = sizeof(CustomerEngineBoard) + (size_t) num_workers * sizeof(CustomerEngineWorker);
+    engine_board_shm_id = shm_region_create("customer_engine", IPC_PRIVATE, size,
+                                            (void **) &engine_board);
+    if (engine_board_shm_id == -1) {
+        return -1;
+    }
+
+    engine_board->num_workers = num_workers;
+    printf("Customers run as state machines on %d engine threads\n", num_workers);
+    return 0;
+}
+
+// True if the customer generator should hand customers to the engine
+bool customer_engine_enabled(void) {
+    return engine_board != NULL;
+}
+
+// Start the worker threads (called by the customer generator)
+int customer_engine_start(BakeryConfig config) {
+    engine_config = config;
+    engine_num_workers = engine_board->num_workers;
+
+    engine_workers = calloc(engine_num_workers, sizeof(EngineWorker));
+    slot_customer = calloc(mailbox_num_slots(), sizeof(int));
+    if (engine_workers == NULL || slot_customer == NULL) {
+        return -1;
+    }
+
+    // All engine customers share one statistics shard
+    stats_bind_worker(ROLE_CUSTOMER, 0);
+
+    // The workers inherit a mask with the stop signals blocked, so SIGINT and SIGTERM are
+    // always taken by the generator thread, where the arrival trace can guard against them
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+
+    for (int i = 0; i < engine_num_workers; i++) {
+        EngineWorker *worker = &engine_workers[i];
+
+        worker->index = i;
+        worker->stats = &engine_board->workers[i];
+        worker->free_head = -1;
+        pthread_mutex_init(&worker->inbox_lock, NULL);
+
+        int rc = pthread_create(&worker->thread, NULL, engine_worker_main, worker);
+        if (rc != 0) {
+            pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+            customer_engine_stop();
+            errno = rc;
+            return -1;
+        }
+        engine_started++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return 0;
+}
+
+// Hand an arriving customer to the next worker, round robin
+int customer_engine_admit(const CustomerArrival *arrival) {
+    EngineWorker *worker = &engine_workers[next_worker++ % engine_num_workers];
+
+    pthread_mutex_lock(&worker->inbox_lock);
+    int rc = reserve_one((void **) &worker->inbox, worker->inbox_count, &worker->inbox_capacity,
+                         sizeof(CustomerArrival));
+    if (rc == 0) {
+        worker->inbox[worker->inbox_count++] = *arrival;
+    }
+    pthread_mutex_unlock(&worker->inbox_lock);
+
+    if (rc == -1) {
+        return -1;
+    }
+
+    wakeup_notify(mailbox_group_channel(worker->index));
+    return 0;
+}
+
+// Stop the worker threads; customers still waiting leave without being counted
+void customer_engine_stop(void) {
+    atomic_store_explicit(&engine_stopping, true, memory_order_release);
+
+    for (int i = 0; i < engine_started; i++) {
+        wakeup_notify(mailbox_group_channel(i));
+    }
+
+    for (int i = 0; i < engine_started; i++) {
+        EngineWorker *worker = &engine_workers[i];
+
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->inbox_lock);
+        free(worker->inbox);
+        free(worker->arrivals);
+        free(worker->customers);
+        free(worker->timers);
+        free(worker->sends);
+    }
+    engine_started = 0;
+
+    free(engine_workers);
+    free(slot_customer);
+    engine_workers = NULL;
+    slot_customer = NULL;
+}
+
+// Print per-thread session counters (used by the summary)
+void customer_engine_print(void) {
+    if (engine_board == NULL) {
+        return;
+    }
+
+    printf("Customer engine (%d threads):\n", engine_board->num_workers);
+    printf("  %-6s %9s %9s %9s %11s %8s %9s\n",
+           "thread", "admitted", "served", "timed out", "turned away", "max wait", "deferred");
+    for (int i = 0; i < engine_board->num_workers; i++) {
+        CustomerEngineWorker *worker = &engine_board->workers[i];
+
+        printf("  %-6d %9lu %9lu %9lu %11lu %8d %9lu\n", i,
+               atomic_load_explicit(&worker->admitted, memory_order_relaxed),
+               atomic_load_explicit(&worker->served, memory_order_relaxed),
+               atomic_load_explicit(&worker->timed_out, memory_order_relaxed),
+               atomic_load_explicit(&worker->turned_away, memory_order_relaxed),
+               atomic_load_explicit(&worker->max_waiting, memory_order_relaxed),
+               atomic_load_explicit(&worker->deferred, memory_order_relaxed));
+    }
+}
+
+// Remove the shared counters (called by the parent during cleanup)
+void customer_engine_destroy(void) {
+    if (engine_board_shm_id != -1) {
+        shm_region_destroy(engine_board_shm_id);
+        engine_board_shm_id = -1;
+        engine_board = NULL;
+    }
+}
+
+// Parse a customer engine name from the config file
+CustomerEngineType parse_customer_engine(const char *name) {
+    if (strncmp(name, "threads", 7) == 0) {
+        return CUSTOMER_ENGINE_THREADS;
+    } else if (strncmp(name, "pool", 4) == 0) {
+        return CUSTOMER_ENGINE_POOL;
+    } else if (strncmp(name, "process", 7) != 0) {
+        fprintf(stderr, "Unknown customer engine '%s', using process\n", name);
+    }
+    return CUSTOMER_ENGINE_PROCESS;
+}
+
+// Human readable engine name for logging
+const char *customer_engine_name(CustomerEngineType type) {
+    const char *names[] = {"process", "threads", "pool"};
+
+    if (type < 0 || type >= CUSTOMER_ENGINE_COUNT) {
+        return "unknown";
+    }
+    return names[type];
+}
@@ -0,0 +1,177 @@
+#include "../include/customer_pool.h"
+#include "../include/histogram.h"
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Arrivals that can wait for a free worker
+#define CUSTOMER_POOL_QUEUE_SLOTS 1024
+
+// Created by the parent before forking, so the generator, its workers and
+// management all inherit the mappings
+static CustomerPoolBoard *pool_board = NULL;
+static int pool_board_shm_id = -1;
+static ShmRing *arrival_ring = NULL;
+static int arrival_ring_shm_id = -1;
+
+// Counters of this worker process
+static CustomerPoolWorker *local_worker = NULL;
+
+// CLOCK_MONOTONIC time CUSTOMER_POOL_POLL_MS from now, for waits on the arrival ring
+static void poll_deadline(struct timespec *deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += CUSTOMER_POOL_POLL_MS / 1000;
+    deadline->tv_nsec += (long) (CUSTOMER_POOL_POLL_MS % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+// Create the pool's board and arrival ring if CUSTOMER_ENGINE=pool
+int customer_pool_create(BakeryConfig config) {
+    if (config.customer_engine != CUSTOMER_ENGINE_POOL) {
+        return 0;
+    }
+
+    if (config.customer_pool_size < 1) {
+        fprintf(stderr, "CUSTOMER_POOL_SIZE must be at least 1\n");
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t size = sizeof(CustomerPoolBoard) +
+                  (size_t) config.customer_pool_size * sizeof(CustomerPoolWorker);
+    pool_board_shm_id = shm_region_create("customer_pool", IPC_PRIVATE, size,
+                                          (void **) &pool_board);
+    if (pool_board_shm_id == -1) {
+        return -1;
+    }
+    pool_board->num_workers = config.customer_pool_size;
+
+    uint32_t capacity = shm_ring_round_capacity(CUSTOMER_POOL_QUEUE_SLOTS);
+    arrival_ring_shm_id = shm_region_create("customer_arrivals", IPC_PRIVATE,
+                                            shm_ring_size(capacity, sizeof(CustomerArrival)),
+                                            (void **) &arrival_ring);
+    if (arrival_ring_shm_id == -1 ||
+        shm_ring_init(arrival_ring, capacity, sizeof(CustomerArrival), WAIT_FUTEX) == -1) {
+        int saved_errno = errno;
+        customer_pool_destroy();
+        errno = saved_errno;
+        return -1;
+    }
+
+    printf("Customers visit through a pool of %d worker processes\n", pool_board->num_workers);
+    return 0;
+}
+
+// True if the customer generator should feed the pool
+bool customer_pool_enabled(void) {
+    return pool_board != NULL;
+}
+
+// Number of worker processes to fork
+int customer_pool_size(void) {
+    return pool_board->num_workers;
+}
+
+// Mark the start of the pool's run (called by the generator once the workers are forked)
+void customer_pool_started(void) {
+    atomic_store_explicit(&pool_board->started_ns, histogram_now_ns(), memory_order_relaxed);
+}
+
+// Queue an arrival for the next free worker, waiting while the queue is full
+int customer_pool_submit(const CustomerArrival *arrival, const ProductionStatus *status) {
+    if (!shm_ring_try_push(arrival_ring, arrival)) {
+        // Every worker is busy and the backlog is full: the pool is too small
+        atomic_fetch_add_explicit(&pool_board->backlog_stalls, 1, memory_order_relaxed);
+
+        // Wait in steps, so a generator stuck here still notices the end of the simulation
+        while (true) {
+            if (!status->simulation_active) {
+                errno = ECANCELED;
+                return -1;
+            }
+
+            struct timespec deadline;
+            poll_deadline(&deadline);
+            if (shm_ring_push(arrival_ring, arrival, &deadline) == 0) {
+                break;
+            }
+            if (errno != ETIMEDOUT && errno != EINTR) {
+                return -1;
+            }
+        }
+    } else {
+        wakeup_notify_one(&arrival_ring->not_empty);
+    }
+
+    atomic_fetch_add_explicit(&pool_board->submitted, 1, memory_order_relaxed);
+    return 0;
+}
+
+// Take the next arrival; -1 with errno ETIMEDOUT after CUSTOMER_POOL_POLL_MS without one
+int customer_pool_take(CustomerArrival *arrival) {
+    struct timespec deadline;
+
+    poll_deadline(&deadline);
+    return shm_ring_pop(arrival_ring, arrival, &deadline);
+}
+
+// Select the counters of this worker process
+void customer_pool_bind_worker(int index) {
+    local_worker = &pool_board->workers[index];
+    atomic_store_explicit(&local_worker->pid, getpid(), memory_order_relaxed);
+}
+
+// Count one finished visit of this worker
+void customer_pool_record_session(uint64_t busy_ns) {
+    atomic_fetch_add_explicit(&local_worker->sessions, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&local_worker->busy_ns, busy_ns, memory_order_relaxed);
+}
+
+// Print per-worker session throughput (used by the summary)
+void customer_pool_print(void) {
+    if (pool_board == NULL) {
+        return;
+    }
+
+    uint64_t started_ns = atomic_load_explicit(&pool_board->started_ns, memory_order_relaxed);
+    double elapsed_s = started_ns > 0 ? (histogram_now_ns() - started_ns) / 1e9 : 0.0;
+
+    printf("Customer pool (%d workers): %lu arrivals, %lu waited for queue space\n",
+           pool_board->num_workers,
+           atomic_load_explicit(&pool_board->submitted, memory_order_relaxed),
+           atomic_load_explicit(&pool_board->backlog_stalls, memory_order_relaxed));
+    printf("  %-6s %8s %8s %9s %9s %6s\n", "worker", "pid", "sessions", "per min", "avg visit", "busy");
+
+    for (int i = 0; i < pool_board->num_workers; i++) {
+        CustomerPoolWorker *worker = &pool_board->workers[i];
+        unsigned long sessions = atomic_load_explicit(&worker->sessions, memory_order_relaxed);
+        double busy_s = atomic_load_explicit(&worker->busy_ns, memory_order_relaxed) / 1e9;
+
+        printf("  %-6d %8d %8lu %9.1f %8.1fs %5.0f%%\n", i,
+               atomic_load_explicit(&worker->pid, memory_order_relaxed), sessions,
+               elapsed_s > 0 ? sessions * 60.0 / elapsed_s : 0.0,
+               sessions > 0 ? busy_s / sessions : 0.0,
+               elapsed_s > 0 ? 100.0 * busy_s / elapsed_s : 0.0);
+    }
+}
+
+// Remove the board and the arrival ring (called by the parent during cleanup)
+void customer_pool_destroy(void) {
+    if (arrival_ring_shm_id != -1) {
+        shm_region_destroy(arrival_ring_shm_id);
+        arrival_ring_shm_id = -1;
+        arrival_ring = NULL;
+    }
+
+    if (pool_board_shm_id != -1) {
+        shm_region_destroy(pool_board_shm_id);
+        pool_board_shm_id = -1;
+        pool_board = NULL;
+    }
+}
@@ -0,0 +1,317 @@
+#include "../include/lock.h"
+#include "../include/lockstat.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+// Ticket lock tuning: pause iterations per waiter ahead of us, and
+// the number of polls before giving the CPU away to the lock holder
+#define TICKET_BACKOFF_BASE 64
+#define TICKET_SPINS_BEFORE_YIELD 100
+
+// Initialize a lock in shared memory (called once by the parent before forking)
+int bakery_lock_init(BakeryLock *lock, LockBackend backend, int sem_id, int sem_num) {
+    memset(lock, 0, sizeof(BakeryLock));
+    lock->backend = backend;
+    lock->sem_id = sem_id;
+    lock->sem_num = sem_num;
+    lock->stat_id = -1;
+
+    if (backend == LOCK_BACKEND_MUTEX) {
+        pthread_mutexattr_t attr;
+        int rc;
+
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        // Robust so a worker killed while holding the lock does not wedge everyone else
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+
+        rc = pthread_mutex_init(&lock->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        if (rc != 0) {
+            errno = rc;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Acquire the lock, blocking until it is available
+static int backend_acquire(BakeryLock *lock) {
+    switch (lock->backend) {
+        case LOCK_BACKEND_SYSV: {
+            struct sembuf op = {lock->sem_num, -1, 0};
+            return semop(lock->sem_id, &op, 1);
+        }
+
+        case LOCK_BACKEND_MUTEX: {
+            int rc = pthread_mutex_lock(&lock->mutex);
+
+            if (rc == EOWNERDEAD) {
+                // Previous owner died inside the critical section, take over the lock
+                fprintf(stderr, "Lock: previous owner died, recovering mutex\n");
+                pthread_mutex_consistent(&lock->mutex);
+                rc = 0;
+            }
+
+            if (rc != 0) {
+                errno = rc;
+                return -1;
+            }
+            return 0;
+        }
+
+        case LOCK_BACKEND_TICKET: {
+            unsigned int ticket = atomic_fetch_add_explicit(&lock->next_ticket, 1,
+                                                            memory_order_relaxed);
+            int spins = 0;
+
+            while (1) {
+                unsigned int serving = atomic_load_explicit(&lock->now_serving,
+                                                             memory_order_acquire);
+                if (serving == ticket) {
+                    return 0;
+                }
+
+                // Back off in proportion to the number of waiters ahead of us
+                unsigned int ahead = ticket - serving;
+                for (unsigned int i = 0; i < ahead * TICKET_BACKOFF_BASE; i++) {
+                    cpu_relax();
+                }
+
+                // The holder may be descheduled, so stop burning its CPU time
+                if (++spins >= TICKET_SPINS_BEFORE_YIELD) {
+                    sched_yield();
+                    spins = 0;
+                }
+            }
+        }
+
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
+
+// Try to acquire the lock without waiting (fails with EAGAIN if it is held)
+static int backend_try_acquire(BakeryLock *lock) {
+    switch (lock->backend) {
+        case LOCK_BACKEND_SYSV: {
+            struct sembuf op = {lock->sem_num, -1, IPC_NOWAIT};
+            return semop(lock->sem_id, &op, 1);
+        }
+
+        case LOCK_BACKEND_MUTEX: {
+            int rc = pthread_mutex_trylock(&lock->mutex);
+
+            if (rc == EOWNERDEAD) {
+                fprintf(stderr, "Lock: previous owner died, recovering mutex\n");
+                pthread_mutex_consistent(&lock->mutex);
+                rc = 0;
+            }
+
+            if (rc != 0) {
+                errno = (rc == EBUSY) ? EAGAIN : rc;
+                return -1;
+            }
+            return 0;
+        }
+
+        case LOCK_BACKEND_TICKET: {
+            // Only take a ticket if it would be served immediately
+            unsigned int serving = atomic_load_explicit(&lock->now_serving, memory_order_acquire);
+            unsigned int expected = serving;
+
+            if (atomic_compare_exchange_strong_explicit(&lock->next_ticket, &expected, serving + 1,
+                                                        memory_order_acquire, memory_order_relaxed)) {
+                return 0;
+            }
+            errno = EAGAIN;
+            return -1;
+        }
+
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
+
+// Release the lock
+static int backend_release(BakeryLock *lock) {
+    switch (lock->backend) {
+        case LOCK_BACKEND_SYSV: {
+            struct sembuf op = {lock->sem_num, 1, 0};
+            return semop(lock->sem_id, &op, 1);
+        }
+
+        case LOCK_BACKEND_MUTEX: {
+            int rc = pthread_mutex_unlock(&lock->mutex);
+
+            if (rc != 0) {
+                errno = rc;
+                return -1;
+            }
+            return 0;
+        }
+
+        case LOCK_BACKEND_TICKET: {
+            // Only the holder writes now_serving, so a plain increment is enough
+            unsigned int serving = atomic_load_explicit(&lock->now_serving, memory_order_relaxed);
+            atomic_store_explicit(&lock->now_serving, serving + 1, memory_order_release);
+            return 0;
+        }
+
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
+
+// Acquire the lock, recording wait and hold times when lock statistics are on
+int bakery_lock_acquire(BakeryLock *lock) {
+    uint64_t start = lockstat_begin();
+    int rc = backend_acquire(lock);
+
+    if (rc == 0) {
+        lockstat_acquired(lock->stat_id, start);
+    }
+    return rc;
+}
+
+// Try to acquire the lock without waiting (fails with EAGAIN if it is held)
+int bakery_lock_try_acquire(BakeryLock *lock) {
+    uint64_t start = lockstat_begin();
+    int rc = backend_try_acquire(lock);
+
+    if (rc == 0) {
+        lockstat_acquired(lock->stat_id, start);
+    } else if (errno == EAGAIN) {
+        lockstat_busy(lock->stat_id);
+    }
+    return rc;
+}
+
+// Release the lock
+int bakery_lock_release(BakeryLock *lock) {
+    lockstat_released(lock->stat_id);
+    return backend_release(lock);
+}
+
+// Take several locks of one array at once, all or nothing, without waiting.
+// The SysV backend does this with a single semop on the semaphore set (the
+// locks must share one set); the others try the locks in ascending index
+// order and roll back on the first one that is busy. Fails with EAGAIN.
+int bakery_lock_try_acquire_set(BakeryLock *locks, const int *indices, int count) {
+    if (count <= 0 || count > LOCK_SET_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t start = lockstat_begin();
+    int rc;
+
+    if (locks[indices[0]].backend == LOCK_BACKEND_SYSV) {
+        struct sembuf ops[LOCK_SET_MAX];
+
+        for (int i = 0; i < count; i++) {
+            ops[i].sem_num = locks[indices[i]].sem_num;
+            ops[i].sem_op = -1;
+            ops[i].sem_flg = IPC_NOWAIT;
+        }
+        rc = semop(locks[indices[0]].sem_id, ops, count);
+    } else {
+        rc = 0;
+        for (int i = 0; i < count; i++) {
+            if (backend_try_acquire(&locks[indices[i]]) == -1) {
+                int saved_errno = errno;
+
+                // Give back what we already hold, in reverse order
+                for (int j = i - 1; j >= 0; j--) {
+                    backend_release(&locks[indices[j]]);
+                }
+                errno = saved_errno;
+                rc = -1;
+                break;
+            }
+        }
+    }
+
+    // Every lock of the set counts as acquired (or found busy) together
+    int saved_errno = errno;
+    for (int i = 0; i < count; i++) {
+        if (rc == 0) {
+            lockstat_acquired(locks[indices[i]].stat_id, start);
+        } else if (saved_errno == EAGAIN) {
+            lockstat_busy(locks[indices[i]].stat_id);
+        }
+    }
+    errno = saved_errno;
+
+    return rc;
+}
+
+// Release a set of locks taken with bakery_lock_try_acquire_set
+int bakery_lock_release_set(BakeryLock *locks, const int *indices, int count) {
+    if (count <= 0 || count > LOCK_SET_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        lockstat_released(locks[indices[i]].stat_id);
+    }
+
+    if (locks[indices[0]].backend == LOCK_BACKEND_SYSV) {
+        struct sembuf ops[LOCK_SET_MAX];
+
+        for (int i = 0; i < count; i++) {
+            ops[i].sem_num = locks[indices[i]].sem_num;
+            ops[i].sem_op = 1;
+            ops[i].sem_flg = 0;
+        }
+        return semop(locks[indices[0]].sem_id, ops, count);
+    }
+
+    int result = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        if (backend_release(&locks[indices[i]]) == -1) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// Release any backend resources (the SysV semaphore itself is removed in cleanup_resources)
+void bakery_lock_destroy(BakeryLock *lock) {
+    if (lock->backend == LOCK_BACKEND_MUTEX) {
+        pthread_mutex_destroy(&lock->mutex);
+    }
+}
+
+// Parse a backend name from the config file
+LockBackend parse_lock_backend(const char *name) {
+    if (strncmp(name, "mutex", 5) == 0) {
+        return LOCK_BACKEND_MUTEX;
+    } else if (strncmp(name, "ticket", 6) == 0) {
+        return LOCK_BACKEND_TICKET;
+    } else if (strncmp(name, "sysv", 4) != 0) {
+        fprintf(stderr, "Unknown lock backend '%s', using sysv\n", name);
+    }
+    return LOCK_BACKEND_SYSV;
+}
+
+// Human readable backend name for logging
+const char *lock_backend_name(LockBackend backend) {
+    const char *names[] = {"sysv", "mutex", "ticket"};
+
+    if (backend < 0 || backend >= LOCK_BACKEND_COUNT) {
+        return "unknown";
+    }
+    return names[backend];
+}
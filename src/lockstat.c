@@ -0,0 +1,139 @@
+#include "../include/lockstat.h"
+#include "../include/shm_region.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Attached by the parent before forking, so every worker inherits the mapping
+static LockStatTable *lockstat_table = NULL;
+
+// Role of this process; the parent and anything unbound counts as management
+static WorkerRole local_role = ROLE_MANAGEMENT;
+
+// When this process took each tracked lock (processes are single threaded)
+static uint64_t acquired_at[LOCKSTAT_MAX_LOCKS];
+
+static const char *role_names[ROLE_COUNT] = {
+    "chef", "baker", "seller", "supply", "customer", "management"
+};
+
+// Create and attach the instrumentation segment
+int lockstat_create(void) {
+    int shm_id = shm_region_create("lockstat", IPC_PRIVATE, sizeof(LockStatTable),
+                                   (void **) &lockstat_table);
+    if (shm_id == -1) {
+        lockstat_table = NULL;
+        return -1;
+    }
+
+    return shm_id;
+}
+
+// Give a lock a row in the table (called by the parent after bakery_lock_init)
+void lockstat_track(BakeryLock *lock, const char *name) {
+    if (lockstat_table == NULL) {
+        return;
+    }
+
+    int id = atomic_load_explicit(&lockstat_table->num_locks, memory_order_relaxed);
+    if (id >= LOCKSTAT_MAX_LOCKS) {
+        fprintf(stderr, "Lock stats: too many locks, not tracking %s\n", name);
+        return;
+    }
+
+    snprintf(lockstat_table->names[id], LOCKSTAT_NAME_LEN, "%s", name);
+    atomic_store_explicit(&lockstat_table->num_locks, id + 1, memory_order_release);
+    lock->stat_id = id;
+}
+
+// Attribute this process's lock operations to a role
+void lockstat_bind_role(WorkerRole role) {
+    local_role = role;
+}
+
+// Timestamp taken before an acquire attempt (0 when instrumentation is off)
+uint64_t lockstat_begin(void) {
+    return lockstat_table != NULL ? histogram_now_ns() : 0;
+}
+
+// Record a successful acquire that started at start
+void lockstat_acquired(int stat_id, uint64_t start) {
+    if (lockstat_table == NULL || stat_id < 0) {
+        return;
+    }
+
+    LockStatCell *cell = &lockstat_table->cells[stat_id][local_role];
+    uint64_t now = histogram_now_ns();
+    uint64_t waited = now - start;
+
+    atomic_fetch_add_explicit(&cell->acquires, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cell->wait_ns, waited, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cell->wait_hist[histogram_bucket(waited)], 1, memory_order_relaxed);
+    acquired_at[stat_id] = now;
+}
+
+// Record a try-acquire that found the lock held
+void lockstat_busy(int stat_id) {
+    if (lockstat_table == NULL || stat_id < 0) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&lockstat_table->cells[stat_id][local_role].busy, 1,
+                              memory_order_relaxed);
+}
+
+// Record a release, closing the hold time started by lockstat_acquired
+void lockstat_released(int stat_id) {
+    if (lockstat_table == NULL || stat_id < 0 || acquired_at[stat_id] == 0) {
+        return;
+    }
+
+    LockStatCell *cell = &lockstat_table->cells[stat_id][local_role];
+    uint64_t held = histogram_now_ns() - acquired_at[stat_id];
+
+    atomic_fetch_add_explicit(&cell->hold_ns, held, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cell->hold_hist[histogram_bucket(held)], 1, memory_order_relaxed);
+    acquired_at[stat_id] = 0;
+}
+
+// Print one line per lock and role that saw any traffic (used by the summary)
+void lockstat_print(void) {
+    if (lockstat_table == NULL) {
+        return;
+    }
+
+    printf("Lock statistics (times in us, percentiles are bucket upper bounds):\n");
+    printf("  %-24s %-10s %9s %8s %9s %8s %9s %8s\n",
+           "lock", "role", "acquires", "busy", "wait avg", "wait p99", "hold avg", "hold p99");
+
+    int num_locks = atomic_load_explicit(&lockstat_table->num_locks, memory_order_acquire);
+    for (int i = 0; i < num_locks; i++) {
+        for (int role = 0; role < ROLE_COUNT; role++) {
+            LockStatCell *cell = &lockstat_table->cells[i][role];
+            unsigned long acquires = atomic_load_explicit(&cell->acquires, memory_order_relaxed);
+            unsigned long busy = atomic_load_explicit(&cell->busy, memory_order_relaxed);
+
+            if (acquires == 0 && busy == 0) {
+                continue;
+            }
+
+            unsigned long long wait_ns = atomic_load_explicit(&cell->wait_ns, memory_order_relaxed);
+            unsigned long long hold_ns = atomic_load_explicit(&cell->hold_ns, memory_order_relaxed);
+            unsigned long divisor = acquires > 0 ? acquires : 1;
+
+            printf("  %-24s %-10s %9lu %8lu %9llu %8lu %9llu %8lu\n",
+                   lockstat_table->names[i], role_names[role], acquires, busy,
+                   wait_ns / 1000 / divisor, histogram_percentile_us(cell->wait_hist, acquires, 99),
+                   hold_ns / 1000 / divisor, histogram_percentile_us(cell->hold_hist, acquires, 99));
+        }
+    }
+}
+
+// Remove the instrumentation segment
+void lockstat_destroy(int lockstat_shm_id) {
+    if (lockstat_shm_id != -1) {
+        shm_region_destroy(lockstat_shm_id);
+    }
+    lockstat_table = NULL;
+}
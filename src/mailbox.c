@@ -0,0 +1,278 @@
+#include "../include/mailbox.h"
+#include "../include/shm_ring.h"
+#include "../include/msgq_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Set in wanted while a seller copies a response into the slot
+#define MAILBOX_WRITING 0x80000000u
+
+// Fewest mailboxes an estimated table gets
+#define MAILBOX_MIN_SLOTS 256
+
+// Created by the parent before forking, so every process inherits the mapping
+static MailboxTable *mailbox_table = NULL;
+static int mailbox_shm_id = -1;
+
+// Milliseconds left until deadline, rounded up; 0 once it has passed
+static long remaining_ms(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long long ns = (long long) (deadline->tv_sec - now.tv_sec) * 1000000000LL +
+                   (deadline->tv_nsec - now.tv_nsec);
+    return ns <= 0 ? 0 : (long) ((ns + 999999) / 1000000);
+}
+
+// Create the mailbox table if RESPONSE_TRANSPORT=mailbox
+int mailbox_create(BakeryConfig config) {
+    if (config.response_transport != RESPONSE_TRANSPORT_MAILBOX) {
+        return 0;
+    }
+
+    // One mailbox per customer that can be waiting at once, estimated like the
+    // customer queue's budget (arrival rate x longest patience) unless configured
+    int wanted = config.mailbox_slots;
+    if (wanted <= 0) {
+        wanted = msgq_inflight_orders(config);
+        wanted = wanted > MAILBOX_MIN_SLOTS ? wanted : MAILBOX_MIN_SLOTS;
+    }
+
+    uint32_t num_slots = shm_ring_round_capacity(wanted);
+    size_t size = sizeof(MailboxTable) + (size_t) num_slots * sizeof(Mailbox);
+
+    mailbox_shm_id = shm_region_create("mailboxes", IPC_PRIVATE, size, (void **) &mailbox_table);
+    if (mailbox_shm_id == -1) {
+        return -1;
+    }
+
+    // The region comes back zeroed: every slot is free
+    mailbox_table->num_slots = num_slots;
+    mailbox_table->mask = num_slots - 1;
+
+    printf("Responses travel through %u shared memory mailboxes\n", num_slots);
+    return 0;
+}
+
+// True if responses should go to mailboxes
+bool mailbox_enabled(void) {
+    return mailbox_table != NULL;
+}
+
+// Number of mailboxes (0 unless RESPONSE_TRANSPORT=mailbox)
+int mailbox_num_slots(void) {
+    return mailbox_table != NULL ? (int) mailbox_table->num_slots : 0;
+}
+
+// Claim a free slot for a customer; -1 if every slot is taken (use the message queue)
+int mailbox_claim(int customer_id) {
+    return mailbox_claim_in_group(customer_id, -1);
+}
+
+// Claim a free slot whose deliveries go on the ready list of group (-1 for none)
+int mailbox_claim_in_group(int customer_id, int group) {
+    if (mailbox_table == NULL || group >= MAILBOX_GROUPS) {
+        return -1;
+    }
+
+    uint32_t start = ((uint32_t) customer_id * 2654435761u) & mailbox_table->mask;
+
+    for (uint32_t i = 0; i < mailbox_table->num_slots; i++) {
+        uint32_t slot = (start + i) & mailbox_table->mask;
+        int free_owner = 0;
+
+        if (atomic_compare_exchange_strong_explicit(&mailbox_table->slots[slot].owner, &free_owner,
+                                                    customer_id + 1, memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            atomic_store_explicit(&mailbox_table->slots[slot].group, group + 1, memory_order_relaxed);
+            return (int) slot;
+        }
+    }
+
+    return -1;
+}
+
+// Start waiting for a new response; returns the sequence to put in the request
+unsigned int mailbox_expect(int slot) {
+    Mailbox *mailbox = &mailbox_table->slots[slot];
+    unsigned int seq;
+
+    // Never 0 and never with the writing bit set
+    do {
+        seq = (atomic_fetch_add_explicit(&mailbox->next_seq, 1, memory_order_relaxed) + 1) &
+              ~MAILBOX_WRITING;
+    } while (seq == 0);
+
+    atomic_store_explicit(&mailbox->wanted, seq, memory_order_release);
+    return seq;
+}
+
+// Put a response in its mailbox and wake the customer; false if nobody waits for it anymore
+bool mailbox_deliver(int slot, unsigned int seq, const CustomerMsg *response) {
+    if (mailbox_table == NULL || slot < 0 || (uint32_t) slot >= mailbox_table->num_slots) {
+        return false;
+    }
+
+    Mailbox *mailbox = &mailbox_table->slots[slot];
+    unsigned int expected = seq;
+
+    // Only one writer, and only while the customer still wants this sequence
+    if (!atomic_compare_exchange_strong_explicit(&mailbox->wanted, &expected, seq | MAILBOX_WRITING,
+                                                 memory_order_acquire, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&mailbox_table->dropped_count, 1, memory_order_relaxed);
+        return false;
+    }
+
+    mailbox->response = *response;
+    atomic_store_explicit(&mailbox->delivered, seq, memory_order_release);
+    wakeup_notify(&mailbox->ready);
+
+    // A grouped slot is delivered at most once per sequence, and its owner keeps it
+    // until the slot came off the ready list, so it is never on the list twice
+    int group = atomic_load_explicit(&mailbox->group, memory_order_relaxed) - 1;
+    if (group >= 0) {
+        MailboxGroup *ready_list = &mailbox_table->groups[group];
+        int head = atomic_load_explicit(&ready_list->head, memory_order_relaxed);
+
+        do {
+            atomic_store_explicit(&mailbox->next_ready, head, memory_order_relaxed);
+        } while (!atomic_compare_exchange_weak_explicit(&ready_list->head, &head, slot + 1,
+                                                        memory_order_release, memory_order_relaxed));
+        wakeup_notify(&ready_list->ready);
+    }
+
+    atomic_fetch_add_explicit(&mailbox_table->delivered_count, 1, memory_order_relaxed);
+    return true;
+}
+
+// Wait for the response with sequence seq until the deadline.
+// Returns 0 with the response copied out, or -1 with errno ETIMEDOUT
+int mailbox_wait(int slot, unsigned int seq, CustomerMsg *response, const struct timespec *deadline) {
+    Mailbox *mailbox = &mailbox_table->slots[slot];
+
+    while (1) {
+        unsigned int seen = wakeup_prepare(&mailbox->ready);
+
+        if (atomic_load_explicit(&mailbox->delivered, memory_order_acquire) == seq) {
+            *response = mailbox->response;
+            return 0;
+        }
+
+        long timeout_ms = remaining_ms(deadline);
+        if (timeout_ms == 0) {
+            break;
+        }
+
+        if (wakeup_wait(&mailbox->ready, seen, (int) timeout_ms) == -1 &&
+            errno != ETIMEDOUT && errno != EINTR) {
+            perror("Customer: Failed to wait on mailbox");
+            break;
+        }
+    }
+
+    // Give up, unless a seller is already writing the response
+    if (mailbox_cancel(slot, seq)) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    // The response made it just in time; wait out the copy
+    while (atomic_load_explicit(&mailbox->delivered, memory_order_acquire) != seq) {
+        cpu_relax();
+    }
+    *response = mailbox->response;
+    return 0;
+}
+
+// Copy out the response with sequence seq if it arrived; -1 with errno EAGAIN otherwise
+int mailbox_take(int slot, unsigned int seq, CustomerMsg *response) {
+    Mailbox *mailbox = &mailbox_table->slots[slot];
+
+    if (atomic_load_explicit(&mailbox->delivered, memory_order_acquire) != seq) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    *response = mailbox->response;
+    return 0;
+}
+
+// Stop waiting for sequence seq; false if a seller is already delivering it
+bool mailbox_cancel(int slot, unsigned int seq) {
+    unsigned int expected = seq;
+
+    return atomic_compare_exchange_strong_explicit(&mailbox_table->slots[slot].wanted, &expected, 0,
+                                                   memory_order_relaxed, memory_order_relaxed);
+}
+
+// Hand the slot back when the customer leaves
+void mailbox_release(int slot) {
+    if (mailbox_table == NULL || slot < 0) {
+        return;
+    }
+
+    Mailbox *mailbox = &mailbox_table->slots[slot];
+    atomic_store_explicit(&mailbox->wanted, 0, memory_order_relaxed);
+    atomic_store_explicit(&mailbox->group, 0, memory_order_relaxed);
+    atomic_store_explicit(&mailbox->owner, 0, memory_order_release);
+}
+
+// Channel notified on every delivery to the group (owners may notify it too)
+WakeupChannel *mailbox_group_channel(int group) {
+    return &mailbox_table->groups[group].ready;
+}
+
+// Take the whole ready list of a group; returns its first slot, or -1 if it is empty
+int mailbox_group_take(int group) {
+    return atomic_exchange_explicit(&mailbox_table->groups[group].head, 0, memory_order_acquire) - 1;
+}
+
+// Slot after slot on a taken ready list, or -1 at the end.
+// Read it before releasing slot: a new owner's delivery would overwrite the link.
+int mailbox_group_next(int slot) {
+    return atomic_load_explicit(&mailbox_table->slots[slot].next_ready, memory_order_relaxed) - 1;
+}
+
+// Print delivery counters (used by the summary)
+void mailbox_print(void) {
+    if (mailbox_table == NULL) {
+        return;
+    }
+
+    printf("Response mailboxes: %ld delivered, %ld dropped (customer had left)\n",
+           atomic_load_explicit(&mailbox_table->delivered_count, memory_order_relaxed),
+           atomic_load_explicit(&mailbox_table->dropped_count, memory_order_relaxed));
+}
+
+// Remove the mailbox table (called by the parent during cleanup)
+void mailbox_destroy(void) {
+    if (mailbox_shm_id != -1) {
+        shm_region_destroy(mailbox_shm_id);
+        mailbox_shm_id = -1;
+        mailbox_table = NULL;
+    }
+}
+
+// Parse a response transport name from the config file
+ResponseTransportType parse_response_transport(const char *name) {
+    if (strncmp(name, "mailbox", 7) == 0) {
+        return RESPONSE_TRANSPORT_MAILBOX;
+    } else if (strncmp(name, "msgq", 4) != 0) {
+        fprintf(stderr, "Unknown response transport '%s', using msgq\n", name);
+    }
+    return RESPONSE_TRANSPORT_MSGQ;
+}
+
+// Human readable response transport name for logging
+const char *response_transport_name(ResponseTransportType type) {
+    const char *names[] = {"msgq", "mailbox"};
+
+    if (type < 0 || type >= RESPONSE_TRANSPORT_COUNT) {
+        return "unknown";
+    }
+    return names[type];
+}
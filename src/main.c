@@ -19,6 +19,19 @@
 #include "../include/customer.h"
 #include "../include/supply_chain.h"
 #include "../include/management.h"
+#include "../include/stats.h"
+#include "../include/lockstat.h"
+#include "../include/order_transport.h"
+#include "../include/mailbox.h"
+#include "../include/order_heap.h"
+#include "../include/order_wire.h"
+#include "../include/msgq_stats.h"
+#include "../include/customer_engine.h"
+#include "../include/customer_pool.h"
+#include "../include/arrivals.h"
+#include "../include/popularity.h"
+#include "../include/arrival_trace.h"
+#include "../include/shm_ring.h"
 
 // Global variables
 BakeryConfig bakery_config;
@@ -32,6 +45,9 @@ int inventory_sem_id = -1;
 int prod_sem_id = -1;
 int customer_msgq_id = -1;
 int management_msgq_id = -1;
+int stats_shm_id = -1;
+int lockstat_shm_id = -1;
+int arena_shm_id = -1;
 
 // Process tracking
 pid_t *chef_pids = NULL;
@@ -40,6 +56,9 @@ pid_t *seller_pids = NULL;
 pid_t *supply_chain_pids = NULL;
 pid_t customer_gen_pid = -1;
 pid_t management_pid = -1;
+pid_t main_pid = -1;
+int num_chef_pids = 0;
+int num_baker_pids = 0;
 
 // Forward declarations
 void cleanup_resources();
@@ -61,13 +80,19 @@ int main(int argc, char *argv[]) {
     // Initialize random seed
     srand(time(NULL));
     
-    // Set up signal handlers
+    // Set up signal handlers (children inherit them, see signal_handler)
+    main_pid = getpid();
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
     // Load configuration from file
     bakery_config = load_config(argv[1]);
     
+    // Namespace this run by our PID unless the config names it
+    if (bakery_config.shm.run_id[0] == '\0') {
+        snprintf(bakery_config.shm.run_id, SHM_RUN_ID_LEN, "%d", (int) main_pid);
+    }
+    
     // Initialize IPC resources
     initialize_ipc_resources();
     
@@ -83,63 +108,70 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
 }
 
+// Key for a SysV semaphore set or queue: the fixed key, or a private object when namespaced
+static key_t ipc_key(key_t fixed_key) {
+    return shm_region_namespaced() ? IPC_PRIVATE : fixed_key;
+}
+
 // Create and initialize all IPC resources needed for the simulation
 void initialize_ipc_resources() {
-    // Create shared memory segments
-    inventory_shm_id = shmget(INVENTORY_SHM_KEY, sizeof(Inventory), IPC_CREAT | 0666);
+    if (shm_region_setup(&bakery_config.shm) == -1) {
+        perror("Invalid shared memory options (RUN_ID may only use letters, digits, '-' and '_')");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("Using %s shared memory, run ID %s\n",
+           shm_backend_name(bakery_config.shm.backend), bakery_config.shm.run_id);
+    
+    // Create and map the shared memory segments (they come back zeroed)
+    inventory_shm_id = shm_region_create("inventory", INVENTORY_SHM_KEY, sizeof(Inventory),
+                                         (void **) &inventory);
     if (inventory_shm_id == -1) {
         perror("Failed to create inventory shared memory");
         exit(EXIT_FAILURE);
     }
     
-    prod_status_shm_id = shmget(PRODUCTION_SHM_KEY, sizeof(ProductionStatus), IPC_CREAT | 0666);
+    prod_status_shm_id = shm_region_create("production", PRODUCTION_SHM_KEY, sizeof(ProductionStatus),
+                                           (void **) &prod_status);
     if (prod_status_shm_id == -1) {
         perror("Failed to create production status shared memory");
-        shmctl(inventory_shm_id, IPC_RMID, NULL); // Clean up since it the only one exits
-        exit(EXIT_FAILURE);
-    }
-    
-    // Attach to shared memory segments
-    inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    if (inventory == (void *) -1) {
-        perror("Failed to attach to inventory shared memory");
-        shmctl(inventory_shm_id, IPC_RMID, NULL);
-        shmctl(prod_status_shm_id, IPC_RMID, NULL);
+        shm_region_destroy(inventory_shm_id); // Clean up since it the only one exits
         exit(EXIT_FAILURE);
     }
     
-    prod_status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
-    if (prod_status == (void *) -1) {
-        perror("Failed to attach to production status shared memory");
-        shmdt(inventory);
-        shmctl(inventory_shm_id, IPC_RMID, NULL);
-        shmctl(prod_status_shm_id, IPC_RMID, NULL);
-        exit(EXIT_FAILURE);
-    }
+    // Clear shared memory before the locks inside it are initialized
+    // (a stale SysV segment from a crashed run is reattached, not recreated)
+    memset(inventory, 0, sizeof(Inventory));
+    memset(prod_status, 0, sizeof(ProductionStatus));
     
-    // Create semaphores
-    inventory_sem_id = semget(INVENTORY_SEM_KEY, 1, IPC_CREAT | 0666);
+    // Create semaphores (the inventory gets one semaphore per raw material)
+    inventory_sem_id = semget(ipc_key(INVENTORY_SEM_KEY), ITEM_RAW_MATERIAL_COUNT, IPC_CREAT | 0666);
     if (inventory_sem_id == -1) {
-        perror("Failed to create inventory semaphore");
+        perror("Failed to create inventory semaphore set");
         cleanup_resources();
         exit(EXIT_FAILURE);
     }
     
-    // Initialize semaphore to 1 (binary semaphore/mutex)
+    // Initialize every semaphore to 1 (binary semaphore/mutex)
     union semun {
         int val;
         struct semid_ds *buf;
         unsigned short *array;
     } sem_arg;
     
-    sem_arg.val = 1;
-    if (semctl(inventory_sem_id, 0, SETVAL, sem_arg) == -1) {
-        perror("Failed to initialize inventory semaphore");
+    unsigned short item_sem_values[ITEM_RAW_MATERIAL_COUNT];
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        item_sem_values[i] = 1;
+    }
+    
+    sem_arg.array = item_sem_values;
+    if (semctl(inventory_sem_id, 0, SETALL, sem_arg) == -1) {
+        perror("Failed to initialize inventory semaphore set");
         cleanup_resources();
         exit(EXIT_FAILURE);
     }
     
-    prod_sem_id = semget(PRODUCTION_SEM_KEY, 1, IPC_CREAT | 0666);
+    prod_sem_id = semget(ipc_key(PRODUCTION_SEM_KEY), 1, IPC_CREAT | 0666);
     if (prod_sem_id == -1) {
         perror("Failed to create production semaphore");
         cleanup_resources();
@@ -147,12 +179,59 @@ void initialize_ipc_resources() {
     }
     
     // Initialize semaphore to 1
+    sem_arg.val = 1;
     if (semctl(prod_sem_id, 0, SETVAL, sem_arg) == -1) {
         perror("Failed to initialize production semaphore");
         cleanup_resources();
         exit(EXIT_FAILURE);
     }
     
+    // Create the lock instrumentation segment first so the locks can be tracked from the start
+    if (bakery_config.lock_stats) {
+        lockstat_shm_id = lockstat_create();
+        if (lockstat_shm_id == -1) {
+            perror("Failed to create lock statistics shared memory");
+            cleanup_resources();
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Initialize the locks living in shared memory (the SysV backend uses the semaphores above)
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        if (bakery_lock_init(&inventory->item_locks[i], bakery_config.lock_backend,
+                             inventory_sem_id, i) == -1) {
+            perror("Failed to initialize inventory locks");
+            cleanup_resources();
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (bakery_lock_init(&prod_status->lock, bakery_config.lock_backend, prod_sem_id, 0) == -1) {
+        perror("Failed to initialize production status lock");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    const char *material_names[ITEM_RAW_MATERIAL_COUNT] = {
+        "wheat", "yeast", "butter", "milk", "sugar_salt", "sweet_items", "cheese_salami"
+    };
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        char name[LOCKSTAT_NAME_LEN];
+        snprintf(name, sizeof(name), "inventory.%s", material_names[i]);
+        lockstat_track(&inventory->item_locks[i], name);
+    }
+    lockstat_track(&prod_status->lock, "production");
+    
+    printf("Using %s lock backend\n", lock_backend_name(bakery_config.lock_backend));
+    
+    // Create the per-worker statistics shards (inherited by every forked process)
+    stats_shm_id = stats_create(bakery_config);
+    if (stats_shm_id == -1) {
+        perror("Failed to create statistics shared memory");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
     // Create message queues
 
     /*
@@ -163,13 +242,19 @@ void initialize_ipc_resources() {
     Facilitates asynchronous interaction between customers and bakery staff
     */
 
-    customer_msgq_id = msgget(CUSTOMER_MSG_KEY, IPC_CREAT | 0666);
+    customer_msgq_id = msgget(ipc_key(CUSTOMER_MSG_KEY), IPC_CREAT | 0666);
     if (customer_msgq_id == -1) {
         perror("Failed to create customer message queue");
         cleanup_resources();
         exit(EXIT_FAILURE);
     }
     
+    // Make room for the expected number of orders in flight, or customers block in msgsnd
+    int inflight_orders = msgq_inflight_orders(bakery_config);
+    if (msgq_raise_limit(customer_msgq_id, inflight_orders * ORDER_WIRE_MAX_PAYLOAD) == -1) {
+        perror("Failed to set customer message queue limit");
+    }
+    
     /*
     Enables communication between supply chain employees and management
     Used for sending urgent supply updates when inventory runs low
@@ -177,16 +262,88 @@ void initialize_ipc_resources() {
     Used for simulation control messages (like termination notifications)
     */
 
-    management_msgq_id = msgget(MANAGEMENT_MSG_KEY, IPC_CREAT | 0666);
+    management_msgq_id = msgget(ipc_key(MANAGEMENT_MSG_KEY), IPC_CREAT | 0666);
     if (management_msgq_id == -1) {
         perror("Failed to create management message queue");
         cleanup_resources();
         exit(EXIT_FAILURE);
     }
     
-    // Initialize shared memory data
-    memset(inventory, 0, sizeof(Inventory));
-    memset(prod_status, 0, sizeof(ProductionStatus));
+    // Orders use the customer queue or a shared memory ring, depending on the config
+    if (order_transport_create(bakery_config, customer_msgq_id) == -1) {
+        perror("Failed to create order transport");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Sellers pick orders through a shared deadline heap with SELLER_SCHEDULING=edf
+    if (order_heap_create(bakery_config) == -1) {
+        perror("Failed to create order heap");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Responses use the customer queue or per-customer mailboxes
+    if (mailbox_create(bakery_config) == -1) {
+        perror("Failed to create response mailboxes");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Customers run as processes or inside the customer generator's engine threads
+    if (customer_engine_create(bakery_config) == -1) {
+        perror("Failed to create customer engine");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    if (customer_pool_create(bakery_config) == -1) {
+        perror("Failed to create customer pool");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Offered load counters, filled in by the customer generator
+    if (arrivals_create(bakery_config) == -1) {
+        perror("Failed to create arrival counters");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Basket popularity tables, inherited by every customer
+    if (popularity_create(bakery_config) == -1) {
+        perror("Failed to build product popularity tables");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Trace file to record arrivals to or replay them from
+    if (arrival_trace_create(bakery_config) == -1) {
+        perror("Failed to open the arrival trace");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Create the shared arena and the per-subtype sales counters that live in it
+    arena_shm_id = shm_arena_create(bakery_config.shm.arena_size);
+    if (arena_shm_id == -1) {
+        perror("Failed to create shared arena");
+        cleanup_resources();
+        exit(EXIT_FAILURE);
+    }
+    
+    for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
+        if (bakery_config.num_categories[i] > 0) {
+            prod_status->subtype_sold[i] = shm_arena_calloc(shm_arena_local(),
+                                                            bakery_config.num_categories[i],
+                                                            sizeof(_Atomic int));
+            if (prod_status->subtype_sold[i] == SHM_NULL) {
+                perror("Failed to allocate subtype counters");
+                cleanup_resources();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
     
     // Set initial values
     prod_status->start_time = time(NULL);
@@ -212,11 +369,13 @@ void start_processes() {
         total_bakers += bakery_config.num_bakers[i];
     }
     
-    // Allocate arrays for process IDs
-    chef_pids = (pid_t *) malloc(total_chefs * sizeof(pid_t));
-    baker_pids = (pid_t *) malloc(total_bakers * sizeof(pid_t));
-    seller_pids = (pid_t *) malloc(bakery_config.num_sellers * sizeof(pid_t));
-    supply_chain_pids = (pid_t *) malloc(bakery_config.num_supply_chain * sizeof(pid_t));
+    // Allocate arrays for process IDs (zeroed so cleanup can tell which were started)
+    num_chef_pids = total_chefs;
+    num_baker_pids = total_bakers;
+    chef_pids = (pid_t *) calloc(total_chefs, sizeof(pid_t));
+    baker_pids = (pid_t *) calloc(total_bakers, sizeof(pid_t));
+    seller_pids = (pid_t *) calloc(bakery_config.num_sellers, sizeof(pid_t));
+    supply_chain_pids = (pid_t *) calloc(bakery_config.num_supply_chain, sizeof(pid_t));
     
     if (!chef_pids || !baker_pids || !seller_pids || !supply_chain_pids) {
         perror("Failed to allocate memory for process IDs");
@@ -236,7 +395,7 @@ void start_processes() {
             } else if (pid == 0) {
                 // Child process (chef)
                 chef_process((ChefType)type, i, inventory_shm_id, prod_status_shm_id, 
-                             inventory_sem_id, prod_sem_id, bakery_config);
+                             bakery_config);
                 exit(EXIT_SUCCESS);  // Should not reach here
             } else {
                 // Parent process
@@ -258,7 +417,7 @@ void start_processes() {
             } else if (pid == 0) {
                 // Child process (baker)
                 baker_process((BakerType)type, i, inventory_shm_id, prod_status_shm_id, 
-                              inventory_sem_id, prod_sem_id, bakery_config);
+                              bakery_config);
                 exit(EXIT_SUCCESS);  // Should not reach here
             } else {
                 // Parent process
@@ -278,7 +437,7 @@ void start_processes() {
         } else if (pid == 0) {
             // Child process (seller)
             seller_process(i, customer_msgq_id, prod_status_shm_id, 
-                          prod_sem_id, bakery_config);
+                          bakery_config);
             exit(EXIT_SUCCESS);  // Should not reach here
         } else {
             // Parent process
@@ -297,7 +456,7 @@ void start_processes() {
         } else if (pid == 0) {
             // Child process (supply chain)
             supply_chain_process(i, inventory_shm_id, prod_status_shm_id,
-                                inventory_sem_id, management_msgq_id, bakery_config);
+                                management_msgq_id, bakery_config);
             exit(EXIT_SUCCESS);  // Should not reach here
         } else {
             // Parent process
@@ -315,7 +474,7 @@ void start_processes() {
     } else if (customer_gen_pid == 0) {
         // Child process (customer generator)
         customer_generator(customer_msgq_id, prod_status_shm_id, 
-                          prod_sem_id, bakery_config);
+                          bakery_config);
         exit(EXIT_SUCCESS);  // Should not reach here
     } else {
         printf("Started customer generator process with PID %d\n", customer_gen_pid);
@@ -331,7 +490,7 @@ void start_processes() {
         // Child process (management)
         management_process(inventory_shm_id, prod_status_shm_id, 
                          management_msgq_id, customer_msgq_id,
-                         inventory_sem_id, prod_sem_id, bakery_config);
+                         bakery_config);
         exit(EXIT_SUCCESS);  // Should not reach here
     } else {
         printf("Started management process with PID %d\n", management_pid);
@@ -342,6 +501,15 @@ void start_processes() {
 
 // Signal handler for graceful termination
 void signal_handler(int sig) {
+    // Children inherit this handler; only the parent owns the IPC resources,
+    // so a child just leaves instead of tearing them down. _exit, because exit
+    // would run stdio and atexit code the signal may have interrupted.
+    // A recording customer generator writes out its arrival trace first
+    if (getpid() != main_pid) {
+        arrival_trace_finish_on_signal();
+        _exit(EXIT_SUCCESS);
+    }
+    
     printf("Received signal %d, terminating...\n", sig);
     
     // Mark simulation as inactive
@@ -353,87 +521,104 @@ void signal_handler(int sig) {
     exit(EXIT_SUCCESS);
 }
 
-// Clean up all allocated resources
-void cleanup_resources() {
-    int status;
-    
-    // Kill all child processes if they are still running
-    if (chef_pids) {
-        for (int i = 0; i < CHEF_TYPE_COUNT; i++) {
-            for (int j = 0; j < bakery_config.num_chefs[i]; j++) {
-                kill(chef_pids[i * bakery_config.num_chefs[0] + j], SIGTERM);
-            }
-        }
-        free(chef_pids);
+// Send SIGTERM to every started process in a pid array, then free it
+static void terminate_processes(pid_t **pids, int count) {
+    if (*pids == NULL) {
+        return;
     }
     
-    if (baker_pids) {
-        for (int i = 0; i < BAKER_TYPE_COUNT; i++) {
-            for (int j = 0; j < bakery_config.num_bakers[i]; j++) {
-                kill(baker_pids[i * bakery_config.num_bakers[0] + j], SIGTERM);
-            }
+    for (int i = 0; i < count; i++) {
+        // Slots of processes that were never forked stay 0, and kill(0) would hit our own group
+        if ((*pids)[i] > 0) {
+            kill((*pids)[i], SIGTERM);
         }
-        free(baker_pids);
     }
     
-    if (seller_pids) {
-        for (int i = 0; i < bakery_config.num_sellers; i++) {
-            kill(seller_pids[i], SIGTERM);
-        }
-        free(seller_pids);
-    }
+    free(*pids);
+    *pids = NULL;
+}
+
+// Clean up all allocated resources (safe to call more than once)
+void cleanup_resources() {
+    int status;
     
-    if (supply_chain_pids) {
-        for (int i = 0; i < bakery_config.num_supply_chain; i++) {
-            kill(supply_chain_pids[i], SIGTERM);
-        }
-        free(supply_chain_pids);
+    // Customer workers are children of the generator, not ours, and are never
+    // signalled; they leave once they see the simulation has ended
+    if (prod_status != NULL) {
+        prod_status->simulation_active = false;
     }
     
+    // Kill all child processes if they are still running
+    terminate_processes(&chef_pids, num_chef_pids);
+    terminate_processes(&baker_pids, num_baker_pids);
+    terminate_processes(&seller_pids, bakery_config.num_sellers);
+    terminate_processes(&supply_chain_pids, bakery_config.num_supply_chain);
+    
     if (customer_gen_pid > 0) {
         kill(customer_gen_pid, SIGTERM);
+        customer_gen_pid = -1;
     }
     
     if (management_pid > 0) {
         kill(management_pid, SIGTERM);
+        management_pid = -1;
     }
     
     // Wait for all child processes to terminate
     while (wait(&status) > 0);
     
-    // Detach and remove shared memory
-    if (inventory != NULL && inventory != (void *) -1) {
-        shmdt(inventory);
-    }
-    
-    if (prod_status != NULL && prod_status != (void *) -1) {
-        shmdt(prod_status);
-    }
-    
-    if (inventory_shm_id != -1) {
-        shmctl(inventory_shm_id, IPC_RMID, NULL);
-    }
-    
-    if (prod_status_shm_id != -1) {
-        shmctl(prod_status_shm_id, IPC_RMID, NULL);
-    }
+    // Destroy locks, then remove shared memory (which unmaps it)
+    if (inventory != NULL) {
+        for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+            bakery_lock_destroy(&inventory->item_locks[i]);
+        }
+        inventory = NULL;
+    }
+    
+    if (prod_status != NULL) {
+        bakery_lock_destroy(&prod_status->lock);
+        prod_status = NULL;
+    }
+    
+    shm_region_destroy(inventory_shm_id);
+    shm_region_destroy(prod_status_shm_id);
+    shm_region_destroy(arena_shm_id);
+    order_transport_destroy();
+    mailbox_destroy();
+    customer_engine_destroy();
+    customer_pool_destroy();
+    arrivals_destroy();
+    popularity_destroy();
+    arrival_trace_destroy();
+    order_heap_destroy();
+    stats_destroy(stats_shm_id);
+    lockstat_destroy(lockstat_shm_id);
+    inventory_shm_id = -1;
+    prod_status_shm_id = -1;
+    arena_shm_id = -1;
+    stats_shm_id = -1;
+    lockstat_shm_id = -1;
     
     // Remove semaphores
     if (inventory_sem_id != -1) {
         semctl(inventory_sem_id, 0, IPC_RMID);
+        inventory_sem_id = -1;
     }
     
     if (prod_sem_id != -1) {
         semctl(prod_sem_id, 0, IPC_RMID);
+        prod_sem_id = -1;
     }
     
     // Remove message queues
     if (customer_msgq_id != -1) {
         msgctl(customer_msgq_id, IPC_RMID, NULL);
+        customer_msgq_id = -1;
     }
     
     if (management_msgq_id != -1) {
         msgctl(management_msgq_id, IPC_RMID, NULL);
+        management_msgq_id = -1;
     }
     
     printf("All resources cleaned up\n");
@@ -458,6 +643,37 @@ BakeryConfig load_config(const char *config_file) {
     config.max_items_per_type[PRODUCT_SWEET_PATISSERIE] = 25;
     config.max_items_per_type[PRODUCT_SAVORY_PATISSERIE] = 25;
     
+    // Default shared arena size
+    config.shm.arena_size = 256 * 1024;
+    
+    // Default order ring (used with ORDER_TRANSPORT=ring)
+    config.order_ring_slots = 1024;
+    config.order_ring_wait = WAIT_FUTEX;
+    
+    // Default mailbox count (used with RESPONSE_TRANSPORT=mailbox; 0 = estimate from the load)
+    config.mailbox_slots = 0;
+    
+    // Sellers serve one order per lock hold unless SELLER_BATCH_SIZE says otherwise
+    config.seller_batch_size = 1;
+    
+    // Threads of the customer engine (used with CUSTOMER_ENGINE=threads)
+    config.customer_engine_threads = 4;
+    
+    // Worker processes of the customer pool (used with CUSTOMER_ENGINE=pool)
+    config.customer_pool_size = 16;
+    
+    // Customers per burst (used with CUSTOMER_ARRIVAL_PROCESS=bursty)
+    config.arrival_burst_size = 10;
+    
+    // Classic Zipf skew (used with PRODUCT_POPULARITY=zipf or SUBTYPE_POPULARITY=zipf)
+    config.zipf_exponent = 1.0;
+    
+    // Trace file (used with ARRIVAL_TRACE=record or replay)
+    snprintf(config.arrival_trace_file, ARRIVAL_TRACE_PATH_LEN, "arrivals.trace");
+    
+    // Default EDF heap size (used with SELLER_SCHEDULING=edf)
+    config.order_heap_slots = 1024;
+    
     fp = fopen(config_file, "r");
     if (!fp) {
         perror("Failed to open configuration file");
@@ -606,6 +822,111 @@ BakeryConfig load_config(const char *config_file) {
                 config.complaint_probability = atof(value);
             } else if (strcmp(key, "CUSTOMER_MAX_PURCHASE_ITEMS") == 0) {
                 config.max_purchase_items = atoi(value);
+            } else if (strcmp(key, "CUSTOMER_VIP_PROBABILITY") == 0) {
+                config.vip_probability = atof(value);
+            } else if (strcmp(key, "CUSTOMER_ENGINE") == 0) {
+                config.customer_engine = parse_customer_engine(value);
+            } else if (strcmp(key, "CUSTOMER_ENGINE_THREADS") == 0) {
+                config.customer_engine_threads = atoi(value);
+            } else if (strcmp(key, "CUSTOMER_POOL_SIZE") == 0) {
+                config.customer_pool_size = atoi(value);
+            } else if (strcmp(key, "CUSTOMER_ARRIVAL_PROCESS") == 0) {
+                config.arrival_process = parse_arrival_process(value);
+            } else if (strcmp(key, "CUSTOMER_ARRIVAL_RATE") == 0) {
+                config.arrival_rate = atof(value);
+            } else if (strcmp(key, "CUSTOMER_ARRIVAL_BURST_SIZE") == 0) {
+                config.arrival_burst_size = atoi(value);
+            }
+            
+            // Product popularity
+            else if (strcmp(key, "PRODUCT_POPULARITY") == 0) {
+                config.product_popularity = parse_popularity_model(value);
+            } else if (strcmp(key, "SUBTYPE_POPULARITY") == 0) {
+                config.subtype_popularity = parse_popularity_model(value);
+            } else if (strcmp(key, "ZIPF_EXPONENT") == 0) {
+                config.zipf_exponent = atof(value);
+            } else if (strcmp(key, "PRODUCT_WEIGHTS") == 0) {
+                config.num_product_weights = parse_popularity_weights(value, config.product_weights,
+                                                                      PRODUCT_PASTE);
+            } else if (strcmp(key, "BREAD_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_BREAD] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_BREAD], MAX_SUBTYPE_WEIGHTS);
+            } else if (strcmp(key, "SANDWICH_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_SANDWICH] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_SANDWICH], MAX_SUBTYPE_WEIGHTS);
+            } else if (strcmp(key, "CAKE_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_CAKE] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_CAKE], MAX_SUBTYPE_WEIGHTS);
+            } else if (strcmp(key, "SWEET_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_SWEET] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_SWEET], MAX_SUBTYPE_WEIGHTS);
+            } else if (strcmp(key, "SWEET_PATISSERIE_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_SWEET_PATISSERIE] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_SWEET_PATISSERIE], MAX_SUBTYPE_WEIGHTS);
+            } else if (strcmp(key, "SAVORY_PATISSERIE_SUBTYPE_WEIGHTS") == 0) {
+                config.num_subtype_weights[PRODUCT_SAVORY_PATISSERIE] = parse_popularity_weights(
+                    value, config.subtype_weights[PRODUCT_SAVORY_PATISSERIE], MAX_SUBTYPE_WEIGHTS);
+            }
+            
+            // Arrival traces
+            else if (strcmp(key, "ARRIVAL_TRACE") == 0) {
+                config.arrival_trace = parse_arrival_trace_mode(value);
+            } else if (strcmp(key, "ARRIVAL_TRACE_FILE") == 0) {
+                snprintf(config.arrival_trace_file, ARRIVAL_TRACE_PATH_LEN, "%.*s",
+                         ARRIVAL_TRACE_PATH_LEN - 1, value);
+            }
+            
+            // Synchronization options
+            else if (strcmp(key, "ATOMIC_COUNTERS") == 0) {
+                config.atomic_counters = atoi(value) != 0;
+            } else if (strcmp(key, "LOCK_BACKEND") == 0) {
+                config.lock_backend = parse_lock_backend(value);
+            } else if (strcmp(key, "EVENT_WAKEUPS") == 0) {
+                config.event_wakeups = atoi(value) != 0;
+            } else if (strcmp(key, "LOCK_STATS") == 0) {
+                config.lock_stats = atoi(value) != 0;
+            }
+            
+            // Shared memory options
+            else if (strcmp(key, "SHM_BACKEND") == 0) {
+                config.shm.backend = parse_shm_backend(value);
+            } else if (strcmp(key, "RUN_ID") == 0) {
+                snprintf(config.shm.run_id, SHM_RUN_ID_LEN, "%.*s", SHM_RUN_ID_LEN - 1, value);
+            } else if (strcmp(key, "SHM_HUGE_PAGES") == 0) {
+                config.shm.huge_pages = atoi(value) != 0;
+            } else if (strcmp(key, "SHM_HUGETLBFS_DIR") == 0) {
+                snprintf(config.shm.hugetlbfs_dir, SHM_HUGETLBFS_DIR_LEN, "%.*s",
+                         SHM_HUGETLBFS_DIR_LEN - 1, value);
+            } else if (strcmp(key, "SHM_PREFAULT") == 0) {
+                config.shm.prefault = atoi(value) != 0;
+            } else if (strcmp(key, "SHM_ARENA_KB") == 0) {
+                config.shm.arena_size = (size_t) atoi(value) * 1024;
+            }
+            
+            // Order transport options
+            else if (strcmp(key, "ORDER_TRANSPORT") == 0) {
+                config.order_transport = parse_order_transport(value);
+            } else if (strcmp(key, "ORDER_RING_SLOTS") == 0) {
+                config.order_ring_slots = atoi(value);
+            } else if (strcmp(key, "ORDER_RING_WAIT") == 0) {
+                config.order_ring_wait = parse_wait_strategy(value);
+            } else if (strcmp(key, "ORDER_PRIORITIES") == 0) {
+                config.order_priorities = atoi(value) != 0;
+            } else if (strcmp(key, "RESPONSE_TRANSPORT") == 0) {
+                config.response_transport = parse_response_transport(value);
+            } else if (strcmp(key, "MAILBOX_SLOTS") == 0) {
+                config.mailbox_slots = atoi(value);
+            } else if (strcmp(key, "MSGQ_INFLIGHT_ORDERS") == 0) {
+                config.msgq_inflight_orders = atoi(value);
+            }
+            
+            // Seller options
+            else if (strcmp(key, "SELLER_BATCH_SIZE") == 0) {
+                config.seller_batch_size = atoi(value);
+            } else if (strcmp(key, "SELLER_SCHEDULING") == 0) {
+                config.seller_scheduling = parse_scheduling_policy(value);
+            } else if (strcmp(key, "ORDER_HEAP_SLOTS") == 0) {
+                config.order_heap_slots = atoi(value);
             }
             
             // Production times
@@ -627,6 +948,20 @@ BakeryConfig load_config(const char *config_file) {
     }
     
     fclose(fp);
+    
+    // A whole basket has to fit in one order message
+    if (config.max_purchase_items > MAX_BASKET_LINES) {
+        fprintf(stderr, "CUSTOMER_MAX_PURCHASE_ITEMS capped to %d\n", MAX_BASKET_LINES);
+        config.max_purchase_items = MAX_BASKET_LINES;
+    }
+    
+    // Engine threads learn about responses through mailbox groups only
+    if (config.customer_engine == CUSTOMER_ENGINE_THREADS &&
+        config.response_transport != RESPONSE_TRANSPORT_MAILBOX) {
+        fprintf(stderr, "CUSTOMER_ENGINE=threads needs mailboxes, using RESPONSE_TRANSPORT=mailbox\n");
+        config.response_transport = RESPONSE_TRANSPORT_MAILBOX;
+    }
+    
     printf("Configuration loaded successfully\n");
     
     return config;
@@ -2,9 +2,21 @@
 #include "../include/chef.h"
 #include "../include/baker.h"
 #include "../include/common.h"
+#include "../include/stats.h"
+#include "../include/lockstat.h"
+#include "../include/counters.h"
+#include "../include/order_transport.h"
+#include "../include/mailbox.h"
+#include "../include/order_heap.h"
+#include "../include/msgq_stats.h"
+#include "../include/customer_engine.h"
+#include "../include/customer_pool.h"
+#include "../include/arrivals.h"
 
 #include <stdio.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
@@ -13,26 +25,28 @@
 #include <sys/msg.h>
 #include <time.h>
 
+// Customer queue samples taken between two checks (5 seconds)
+#define QUEUE_SAMPLES_PER_CHECK 20
+#define QUEUE_SAMPLE_INTERVAL_US 250000
+
+// How long to keep retrying an end message while the order transport is full
+#define END_SEND_ATTEMPTS 200
+#define END_SEND_RETRY_US 10000
+
 // Management process
 void management_process(int inventory_shm_id, int prod_status_shm_id,
                       int management_msgq_id, int customer_msgq_id,
-                      int inventory_sem_id, int prod_sem_id, BakeryConfig config) {
+                      BakeryConfig config) {
     
     // Attach to shared memory segments
-    Inventory *inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    Inventory *inventory = (Inventory *) shm_region_attach(inventory_shm_id);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (inventory == (void *) -1 || status == (void *) -1) {
+    if (inventory == NULL || status == NULL) {
         perror("Management: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Define semaphore operations
-    struct sembuf inventory_lock = {0, -1, 0};   // Lock inventory
-    struct sembuf inventory_unlock = {0, 1, 0};  // Unlock inventory
-    struct sembuf prod_lock = {0, -1, 0};        // Lock production status
-    struct sembuf prod_unlock = {0, 1, 0};       // Unlock production status
-    
     // Create chef teams data
     ChefTeam chef_teams[CHEF_TYPE_COUNT];
     initialize_chef_teams(chef_teams, config);
@@ -43,6 +57,9 @@ void management_process(int inventory_shm_id, int prod_status_shm_id,
         .decision_count = 0
     };
     
+    // Customer queue telemetry, sampled while waiting between checks
+    MsgqStats queue_stats = {0};
+    
     // Message structure for supply chain updates or management decisions
     union {
         struct {
@@ -72,15 +89,13 @@ void management_process(int inventory_shm_id, int prod_status_shm_id,
         // Check if we need to rebalance production
         time_t current_time = time(NULL);
         if (current_time - mgmt_data.last_decision_time >= 60) {  // Make decisions every minute
-            // Lock production status
-            if (semop(prod_sem_id, &prod_lock, 1) == -1) {
-                perror("Management: Failed to lock production status semaphore");
-                break;
-            }
+            // Take a consistent copy of the production status without blocking workers
+            ProductionSnapshot snapshot;
+            read_production_snapshot(status, &snapshot);
             
             // Analyze production needs
             ManagementMsg decision;
-            analyze_production_needs(status, chef_teams, &decision);
+            analyze_production_needs(&snapshot, chef_teams, &decision);
             
             // Execute management decisions
             if (decision.num_chefs_to_move > 0) {
@@ -92,13 +107,7 @@ void management_process(int inventory_shm_id, int prod_status_shm_id,
             mgmt_data.decision_count++;
             
             // Check end conditions
-            check_end_conditions(status, config, &should_end);
-            
-            // Unlock production status
-            if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
-                perror("Management: Failed to unlock production status semaphore");
-                break;
-            }
+            check_end_conditions(&snapshot, config, &should_end);
         }
         
         // If end conditions are met, end the simulation
@@ -107,30 +116,74 @@ void management_process(int inventory_shm_id, int prod_status_shm_id,
             status->simulation_active = false;
             
             // Notify all processes to terminate
-            notify_all_processes(customer_msgq_id, management_msgq_id);
+            notify_all_processes(customer_msgq_id, management_msgq_id, config.num_sellers);
             break;
         }
         
-        // Sleep for a while before checking again
-        sleep(5);  // Check every 5 seconds
+        // Sample the customer queue while waiting before checking again (every 5 seconds)
+        for (int i = 0; i < QUEUE_SAMPLES_PER_CHECK; i++) {
+            msgq_sample(customer_msgq_id, &queue_stats);
+            usleep(QUEUE_SAMPLE_INTERVAL_US);
+        }
     }
     
-    // Print simulation summary
+    // Print simulation summary from one consistent snapshot
+    ProductionSnapshot final_status;
+    read_production_snapshot(status, &final_status);
+    StatsTotals totals;
+    stats_merge(&totals);
+    
     printf("\n======== BAKERY SIMULATION SUMMARY ========\n");
-    printf("Total profit: $%.2f\n", status->total_profit);
-    printf("Simulation duration: %ld minutes\n", (time(NULL) - status->start_time) / 60);
+    printf("Total profit: $%.2f\n", final_status.total_profit);
+    printf("Simulation duration: %ld minutes\n", (time(NULL) - final_status.start_time) / 60);
     printf("Produced items:\n");
     for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
-        printf("  Type %d: %d\n", i, status->produced_items[i]);
+        printf("  Type %d: %d\n", i, final_status.produced_items[i]);
     }
     printf("Sold items:\n");
     for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
-        printf("  Type %d: %d\n", i, status->sold_items[i]);
+        printf("  Type %d: %d\n", i, final_status.sold_items[i]);
+    }
+    printf("Sold items per subtype:\n");
+    for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
+        _Atomic int *subtype_sold = shm_arena_ptr(shm_arena_local(), status->subtype_sold[i]);
+        if (subtype_sold == NULL) {
+            continue;
+        }
+        
+        printf("  Type %d:", i);
+        for (int j = 0; j < config.num_categories[i]; j++) {
+            printf(" %d", counter_read(&subtype_sold[j]));
+        }
+        printf("\n");
     }
-    printf("Frustrated customers: %d\n", status->frustrated_customers);
-    printf("Complained customers: %d\n", status->complained_customers);
-    printf("Missing items requests: %d\n", status->missing_items_requests);
+    printf("Frustrated customers: %d\n", final_status.frustrated_customers);
+    printf("Complained customers: %d\n", final_status.complained_customers);
+    printf("Missing items requests: %d\n", final_status.missing_items_requests);
+    printf("Expired orders skipped: %d\n", totals.expired_orders);
+    // The same outcomes per customer, so fifo and edf runs under the same load compare directly
+    unsigned long customers = arrivals_count();
+    printf("Seller scheduling: %s, per 100 customers: %.1f frustrated, %.1f missing items, "
+           "%.1f expired orders\n", scheduling_policy_name(config.seller_scheduling),
+           customers > 0 ? 100.0 * final_status.frustrated_customers / customers : 0.0,
+           customers > 0 ? 100.0 * final_status.missing_items_requests / customers : 0.0,
+           customers > 0 ? 100.0 * totals.expired_orders / customers : 0.0);
     printf("Management decisions: %d\n", mgmt_data.decision_count);
+    stats_print_workers(ROLE_CHEF, "Items prepared per chef");
+    stats_print_workers(ROLE_BAKER, "Items baked per baker");
+    stats_print_workers(ROLE_SELLER, "Items sold per seller");
+    if (config.seller_batch_size > 1) {
+        stats_print_batches();
+    }
+    lockstat_print();
+    order_transport_print();
+    msgq_print("Customer queue", &queue_stats);
+    order_heap_print();
+    shm_arena_print(shm_arena_local());
+    mailbox_print();
+    arrivals_print();
+    customer_engine_print();
+    customer_pool_print();
     printf("==========================================\n");
     
     printf("Management process terminating (PID: %d)\n", getpid());
@@ -141,12 +194,12 @@ void management_process(int inventory_shm_id, int prod_status_shm_id,
     }
     
     // Detach from shared memory
-    shmdt(inventory);
-    shmdt(status);
+    shm_region_detach(inventory_shm_id, inventory);
+    shm_region_detach(prod_status_shm_id, status);
 }
 
 // Analyze production needs and make management decisions
-void analyze_production_needs(ProductionStatus *status, ChefTeam *teams, ManagementMsg *msg) {
+void analyze_production_needs(ProductionSnapshot *status, ChefTeam *teams, ManagementMsg *msg) {
     // Default decision: no reallocation
     msg->msg_type = MSG_MANAGEMENT_DECISION;
     msg->chef_type_from = 0;
@@ -280,7 +333,7 @@ void analyze_production_needs(ProductionStatus *status, ChefTeam *teams, Managem
 }
 
 // Check end conditions for the simulation
-void check_end_conditions(ProductionStatus *status, BakeryConfig config, bool *should_end) {
+void check_end_conditions(ProductionSnapshot *status, BakeryConfig config, bool *should_end) {
     *should_end = false;
     
     // Check thresholds
@@ -317,9 +370,20 @@ void reassign_chefs(ChefTeam *teams, ManagementMsg *decision) {
                    decision->num_chefs_to_move);
 }
 
+// Send one end message, retrying for a while if the order transport is full
+static int send_seller_end(const CustomerMsg *end_msg) {
+    for (int attempt = 1; order_try_send(end_msg) == -1; attempt++) {
+        if (errno != EAGAIN || attempt == END_SEND_ATTEMPTS) {
+            return -1;
+        }
+        usleep(END_SEND_RETRY_US);
+    }
+    return 0;
+}
+
 // Notify all processes that the simulation is ending
-void notify_all_processes(int customer_msgq_id, int management_msgq_id) {
-    // Send end message to customer message queue
+void notify_all_processes(int customer_msgq_id, int management_msgq_id, int num_sellers) {
+    // End message for the management queue
     struct {
         long msg_type;
         int signal;
@@ -328,8 +392,18 @@ void notify_all_processes(int customer_msgq_id, int management_msgq_id) {
     end_msg.msg_type = MSG_SIMULATION_END;
     end_msg.signal = 1;
     
-    if (msgsnd(customer_msgq_id, &end_msg, sizeof(int), 0) == -1) {
-        perror("Management: Failed to send end message to customer queue");
+    // One per seller through the order transport, since each blocked seller consumes exactly one.
+    // While the transport is full no seller is blocked, and sellers that see simulation_active
+    // cleared leave without draining it, so retry for a while instead of waiting for room
+    CustomerMsg seller_end_msg;
+    memset(&seller_end_msg, 0, sizeof(CustomerMsg));
+    seller_end_msg.msg_type = MSG_SIMULATION_END;
+    
+    for (int i = 0; i < num_sellers; i++) {
+        if (send_seller_end(&seller_end_msg) == -1) {
+            perror("Management: Failed to send end message to sellers");
+            break;
+        }
     }
     
     // Send end message to management message queue
@@ -0,0 +1,138 @@
+#include "../include/msgq_stats.h"
+#include "../include/order_wire.h"
+#include "../include/arrivals.h"
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+
+// Smallest queue budget, in orders, whatever the config says
+#define MSGQ_MIN_INFLIGHT_ORDERS 64
+
+// Largest estimate, far beyond what any kernel lets a queue hold
+#define MSGQ_MAX_INFLIGHT_ORDERS 1000000
+
+// Largest msg_qbytes an unprivileged process may set (0 if unknown)
+static unsigned long read_msgmnb(void) {
+    unsigned long msgmnb = 0;
+    FILE *file = fopen("/proc/sys/kernel/msgmnb", "r");
+
+    if (file == NULL) {
+        return 0;
+    }
+    if (fscanf(file, "%lu", &msgmnb) != 1) {
+        msgmnb = 0;
+    }
+    fclose(file);
+    return msgmnb;
+}
+
+// Bytes currently queued
+static unsigned long queued_bytes(const struct msqid_ds *info) {
+#ifdef __linux__
+    return info->__msg_cbytes;
+#else
+    // Assume full baskets where the kernel does not report the byte count
+    return info->msg_qnum * ORDER_WIRE_MAX_PAYLOAD;
+#endif
+}
+
+// Raise msg_qbytes of the queue to at least wanted_bytes.
+// Without CAP_SYS_RESOURCE the kernel refuses to go above msgmnb (EPERM); the
+// queue then gets msgmnb and a warning, which is not treated as an error.
+int msgq_raise_limit(int msgq_id, unsigned long wanted_bytes) {
+    struct msqid_ds info;
+
+    if (msgctl(msgq_id, IPC_STAT, &info) == -1) {
+        return -1;
+    }
+
+    unsigned long old_bytes = info.msg_qbytes;
+    if (old_bytes >= wanted_bytes) {
+        printf("Message queue limit: %lu bytes, enough for %lu wanted\n", old_bytes, wanted_bytes);
+        return 0;
+    }
+
+    info.msg_qbytes = wanted_bytes;
+    if (msgctl(msgq_id, IPC_SET, &info) == 0) {
+        printf("Message queue limit raised from %lu to %lu bytes\n", old_bytes, wanted_bytes);
+        return 0;
+    }
+    if (errno != EPERM) {
+        return -1;
+    }
+
+    // Take as much as an unprivileged process is allowed
+    unsigned long ceiling = read_msgmnb();
+    if (ceiling > old_bytes) {
+        info.msg_qbytes = ceiling;
+        if (msgctl(msgq_id, IPC_SET, &info) == 0) {
+            old_bytes = ceiling;
+        }
+    }
+
+    fprintf(stderr, "Message queue limit: %lu bytes, wanted %lu (raise kernel.msgmnb or run with "
+            "CAP_SYS_RESOURCE); senders will stall when it fills\n", old_bytes, wanted_bytes);
+    return 0;
+}
+
+// Orders the customer queue should hold at once (MSGQ_INFLIGHT_ORDERS, 0 = estimate)
+int msgq_inflight_orders(BakeryConfig config) {
+    if (config.msgq_inflight_orders > 0) {
+        return config.msgq_inflight_orders;
+    }
+
+    // Each waiting customer has one order or response queued at most, and by
+    // Little's law about rate x patience customers wait at once; size for the
+    // longest patience plus a whole burst. Sellers add their end messages and
+    // the orders they hold in a batch.
+    double waiting = arrivals_offered_rate(config) * config.customer_params[3] +
+                     (config.arrival_burst_size > 1 ? config.arrival_burst_size : 1);
+    double orders = waiting + config.num_sellers * (config.seller_batch_size + 1);
+
+    if (orders > MSGQ_MAX_INFLIGHT_ORDERS) {
+        return MSGQ_MAX_INFLIGHT_ORDERS;
+    }
+    return orders > MSGQ_MIN_INFLIGHT_ORDERS ? (int) orders : MSGQ_MIN_INFLIGHT_ORDERS;
+}
+
+// Record the current depth and bytes of the queue
+int msgq_sample(int msgq_id, MsgqStats *stats) {
+    struct msqid_ds info;
+
+    if (msgctl(msgq_id, IPC_STAT, &info) == -1) {
+        return -1;
+    }
+
+    unsigned long depth = info.msg_qnum;
+    unsigned long bytes = queued_bytes(&info);
+
+    stats->samples++;
+    stats->depth_sum += depth;
+    stats->limit_bytes = info.msg_qbytes;
+    if (depth > stats->max_depth) {
+        stats->max_depth = depth;
+    }
+    if (bytes > stats->max_bytes) {
+        stats->max_bytes = bytes;
+    }
+    if (bytes + ORDER_WIRE_MAX_PAYLOAD > info.msg_qbytes) {
+        stats->full_samples++;
+    }
+    return 0;
+}
+
+// Print the samples of a queue (used by the summary)
+void msgq_print(const char *label, const MsgqStats *stats) {
+    if (stats->samples == 0) {
+        return;
+    }
+
+    printf("%s: %lu samples, avg depth %.1f, max depth %lu, max %lu of %lu bytes (%.1f%%), "
+           "full in %lu samples\n", label, stats->samples,
+           (double) stats->depth_sum / stats->samples, stats->max_depth, stats->max_bytes,
+           stats->limit_bytes,
+           stats->limit_bytes > 0 ? 100.0 * stats->max_bytes / stats->limit_bytes : 0.0,
+           stats->full_samples);
+}
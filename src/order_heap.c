@@ -0,0 +1,310 @@
+#include "../include/order_heap.h"
+#include "../include/lockstat.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+// Created by the parent before forking, so every seller inherits the mapping
+static OrderHeap *order_heap = NULL;
+static int order_heap_shm_id = -1;
+static int order_heap_sem_id = -1;  // Only for LOCK_BACKEND_SYSV
+
+// Heap positions, stored after the slots: heap_slots()[0] is the slot served next
+static int *heap_slots(void) {
+    return (int *) &order_heap->entries[order_heap->capacity];
+}
+
+// True if the order in slot a must be served before the one in slot b
+static bool served_before(int slot_a, int slot_b) {
+    const OrderHeapEntry *a = &order_heap->entries[slot_a];
+    const OrderHeapEntry *b = &order_heap->entries[slot_b];
+
+    if (order_heap->by_class && a->order.order_class != b->order.order_class) {
+        return a->order.order_class < b->order.order_class;
+    }
+
+    // No deadline sorts after every deadline
+    uint64_t a_deadline = a->order.deadline_ns != 0 ? a->order.deadline_ns : UINT64_MAX;
+    uint64_t b_deadline = b->order.deadline_ns != 0 ? b->order.deadline_ns : UINT64_MAX;
+    if (a_deadline != b_deadline) {
+        return a_deadline < b_deadline;
+    }
+
+    return a->arrival < b->arrival;
+}
+
+static void swap_entries(int i, int j) {
+    int *heap = heap_slots();
+    int tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+// Move position i up until its parent is served before it
+static void sift_up(int i) {
+    int *heap = heap_slots();
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (!served_before(heap[i], heap[parent])) {
+            break;
+        }
+        swap_entries(i, parent);
+        i = parent;
+    }
+}
+
+// Move position i down until both children are served after it
+static void sift_down(int i) {
+    int *heap = heap_slots();
+
+    while (1) {
+        int first = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < order_heap->size && served_before(heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < order_heap->size && served_before(heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == i) {
+            break;
+        }
+        swap_entries(i, first);
+        i = first;
+    }
+}
+
+// Undo a partially created heap, keeping errno; returns -1
+static int abandon_create(void) {
+    int saved_errno = errno;
+    order_heap_destroy();
+    errno = saved_errno;
+    return -1;
+}
+
+// Create the heap if SELLER_SCHEDULING=edf
+int order_heap_create(BakeryConfig config) {
+    if (config.seller_scheduling != SCHEDULING_EDF) {
+        return 0;
+    }
+
+    int capacity = config.order_heap_slots > 0 ? config.order_heap_slots : 1;
+    size_t size = sizeof(OrderHeap) + (size_t) capacity * (sizeof(OrderHeapEntry) + sizeof(int));
+
+    order_heap_shm_id = shm_region_create("order_heap", IPC_PRIVATE, size, (void **) &order_heap);
+    if (order_heap_shm_id == -1) {
+        return -1;
+    }
+
+    // The SysV backend needs a semaphore of its own
+    if (config.lock_backend == LOCK_BACKEND_SYSV) {
+        order_heap_sem_id = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+        if (order_heap_sem_id == -1 || semctl(order_heap_sem_id, 0, SETVAL, 1) == -1) {
+            return abandon_create();
+        }
+    }
+
+    if (bakery_lock_init(&order_heap->lock, config.lock_backend, order_heap_sem_id, 0) == -1) {
+        return abandon_create();
+    }
+    lockstat_track(&order_heap->lock, "order_heap");
+
+    order_heap->by_class = config.order_priorities;
+    order_heap->capacity = capacity;
+    order_heap->oldest = -1;
+    order_heap->newest = -1;
+
+    // Every slot starts on the free list
+    for (int i = 0; i < capacity; i++) {
+        order_heap->entries[i].newer = i + 1 < capacity ? i + 1 : -1;
+    }
+    order_heap->free_head = 0;
+
+    printf("Sellers serve the earliest deadline first (heap of %d orders)\n", capacity);
+    return 0;
+}
+
+// True if sellers schedule through the heap
+bool order_heap_enabled(void) {
+    return order_heap != NULL;
+}
+
+// Add an order; -1 with errno ENOSPC if the heap is full
+int order_heap_push(const CustomerMsg *order) {
+    if (bakery_lock_acquire(&order_heap->lock) == -1) {
+        return -1;
+    }
+
+    if (order_heap->size == order_heap->capacity) {
+        bakery_lock_release(&order_heap->lock);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    int slot = order_heap->free_head;
+    OrderHeapEntry *entry = &order_heap->entries[slot];
+    order_heap->free_head = entry->newer;
+
+    entry->arrival = order_heap->next_arrival++;
+    entry->order = *order;
+
+    // Arrivals only grow, so the new entry is the newest
+    entry->older = order_heap->newest;
+    entry->newer = -1;
+    if (order_heap->newest != -1) {
+        order_heap->entries[order_heap->newest].newer = slot;
+    } else {
+        order_heap->oldest = slot;
+    }
+    order_heap->newest = slot;
+
+    int i = order_heap->size++;
+    heap_slots()[i] = slot;
+    sift_up(i);
+
+    if (order_heap->size > order_heap->max_size) {
+        order_heap->max_size = order_heap->size;
+    }
+
+    int rc = bakery_lock_release(&order_heap->lock);
+
+    // Wake an idle seller to serve it
+    wakeup_notify_one(&order_heap->pushed);
+    return rc;
+}
+
+// Take the order with the earliest deadline; -1 with errno EAGAIN if the heap is empty
+int order_heap_pop(CustomerMsg *order) {
+    if (bakery_lock_acquire(&order_heap->lock) == -1) {
+        return -1;
+    }
+
+    if (order_heap->size == 0) {
+        bakery_lock_release(&order_heap->lock);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    int *heap = heap_slots();
+    int slot = heap[0];
+    OrderHeapEntry *entry = &order_heap->entries[slot];
+    *order = entry->order;
+
+    order_heap->size--;
+    if (order_heap->size > 0) {
+        heap[0] = heap[order_heap->size];
+        sift_down(0);
+    }
+
+    order_heap->dispatches++;
+    if (slot != order_heap->oldest) {
+        // FIFO would have served an older order now
+        order_heap->reordered++;
+    }
+
+    // Unlink the entry from the arrival list and free its slot
+    if (entry->older != -1) {
+        order_heap->entries[entry->older].newer = entry->newer;
+    } else {
+        order_heap->oldest = entry->newer;
+    }
+    if (entry->newer != -1) {
+        order_heap->entries[entry->newer].older = entry->older;
+    } else {
+        order_heap->newest = entry->older;
+    }
+    entry->newer = order_heap->free_head;
+    order_heap->free_head = slot;
+
+    return bakery_lock_release(&order_heap->lock);
+}
+
+// True if no more orders fit (read without the lock, a hint for draining)
+bool order_heap_full(void) {
+    return order_heap->size >= order_heap->capacity;
+}
+
+// True if no order is waiting (read without the lock, a hint for idle sellers)
+bool order_heap_empty(void) {
+    return order_heap->size == 0;
+}
+
+// Become the seller that waits on the transport while the heap is empty; false if
+// another seller already does
+bool order_heap_claim_receiver(void) {
+    int expected = 0;
+    return atomic_compare_exchange_strong(&order_heap->receiver, &expected, 1);
+}
+
+// Stop waiting on the transport and let another idle seller take over
+void order_heap_release_receiver(void) {
+    atomic_store(&order_heap->receiver, 0);
+    wakeup_notify(&order_heap->pushed);
+}
+
+// Read the pushed channel before checking the heap (see wakeup.h)
+unsigned int order_heap_prepare_wait(void) {
+    return wakeup_prepare(&order_heap->pushed);
+}
+
+// Sleep until an order is pushed, the receiver changes or ORDER_HEAP_IDLE_WAIT_MS pass
+int order_heap_wait(unsigned int seen) {
+    return wakeup_wait(&order_heap->pushed, seen, ORDER_HEAP_IDLE_WAIT_MS);
+}
+
+// Print scheduling counters (used by the summary)
+void order_heap_print(void) {
+    if (order_heap == NULL) {
+        return;
+    }
+
+    printf("EDF heap: %lu dispatches, %lu reordered ahead of an older order (%.1f%%), max depth %d\n",
+           order_heap->dispatches, order_heap->reordered,
+           order_heap->dispatches > 0 ? 100.0 * order_heap->reordered / order_heap->dispatches : 0.0,
+           order_heap->max_size);
+}
+
+// Remove the heap and its semaphore (called by the parent during cleanup)
+void order_heap_destroy(void) {
+    if (order_heap != NULL) {
+        bakery_lock_destroy(&order_heap->lock);
+        order_heap = NULL;
+    }
+
+    if (order_heap_shm_id != -1) {
+        shm_region_destroy(order_heap_shm_id);
+        order_heap_shm_id = -1;
+    }
+
+    if (order_heap_sem_id != -1) {
+        semctl(order_heap_sem_id, 0, IPC_RMID);
+        order_heap_sem_id = -1;
+    }
+}
+
+// Parse a scheduling policy name from the config file
+SchedulingPolicy parse_scheduling_policy(const char *name) {
+    if (strncmp(name, "edf", 3) == 0) {
+        return SCHEDULING_EDF;
+    } else if (strncmp(name, "fifo", 4) != 0) {
+        fprintf(stderr, "Unknown seller scheduling '%s', using fifo\n", name);
+    }
+    return SCHEDULING_FIFO;
+}
+
+// Human readable policy name for logging
+const char *scheduling_policy_name(SchedulingPolicy policy) {
+    const char *names[] = {"fifo", "edf"};
+
+    if (policy < 0 || policy >= SCHEDULING_POLICY_COUNT) {
+        return "unknown";
+    }
+    return names[policy];
+}
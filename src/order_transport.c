@@ -0,0 +1,346 @@
+#include "../include/order_transport.h"
+#include "../include/shm_ring.h"
+#include "../include/order_wire.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+
+// Transport selected by the parent, inherited by every forked process
+static OrderTransportType transport = ORDER_TRANSPORT_MSGQ;
+static bool priorities = false;
+static int order_msgq_id = -1;
+
+// Ring transport: one ring, or one per class when priorities are on
+static ShmRing *order_rings[ORDER_CLASS_COUNT];
+static int order_ring_shm_ids[ORDER_CLASS_COUNT] = {-1, -1, -1};
+static int num_rings = 0;
+static WaitStrategy ring_wait = WAIT_FUTEX;
+
+static OrderBoard *order_board = NULL;
+static int order_board_shm_id = -1;
+
+static const char *class_names[ORDER_CLASS_COUNT] = {"vip", "regular", "complaint"};
+
+// Message type of an order on the customer queue
+static long message_type(const CustomerMsg *msg) {
+    static const long class_types[ORDER_CLASS_COUNT] = {
+        MSG_VIP_REQUEST, MSG_CUSTOMER_REQUEST, MSG_CUSTOMER_COMPLAINT
+    };
+
+    if (msg->msg_type == MSG_SIMULATION_END) {
+        return MSG_SIMULATION_END;
+    }
+    return priorities ? class_types[msg->order_class] : MSG_CUSTOMER_REQUEST;
+}
+
+// Ring an order goes to; end messages go to the last ring so every order is served first
+static ShmRing *ring_for(const CustomerMsg *msg) {
+    if (msg->msg_type == MSG_SIMULATION_END) {
+        return order_rings[num_rings - 1];
+    }
+    return order_rings[priorities ? msg->order_class : 0];
+}
+
+// Statistics of the class of an order, NULL for end messages
+static OrderClassStats *class_stats(const CustomerMsg *msg) {
+    if (order_board == NULL || msg->msg_type == MSG_SIMULATION_END ||
+        msg->order_class < 0 || msg->order_class >= ORDER_CLASS_COUNT) {
+        return NULL;
+    }
+    return &order_board->classes[msg->order_class];
+}
+
+// Account for an order that is about to enter the channel
+static void record_enqueue(OrderClassStats *stats) {
+    int depth = atomic_fetch_add_explicit(&stats->depth, 1, memory_order_relaxed) + 1;
+    int max_depth = atomic_load_explicit(&stats->max_depth, memory_order_relaxed);
+
+    while (depth > max_depth &&
+           !atomic_compare_exchange_weak_explicit(&stats->max_depth, &max_depth, depth,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+        // max_depth was reloaded by the failed exchange, try again
+    }
+    atomic_fetch_add_explicit(&stats->sent, 1, memory_order_relaxed);
+}
+
+// Account for an order that left the channel, and for how long it queued
+static void record_dequeue(const CustomerMsg *msg) {
+    OrderClassStats *stats = class_stats(msg);
+    if (stats == NULL) {
+        return;
+    }
+
+    uint64_t waited = histogram_now_ns() - msg->enqueued_ns;
+
+    atomic_fetch_sub_explicit(&stats->depth, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->received, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->wait_ns, waited, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->wait_hist[histogram_bucket(waited)], 1, memory_order_relaxed);
+}
+
+// Put an order on its ring, counting a stall if the ring was full (EAGAIN unless wait)
+static int push_order(ShmRing *ring, const CustomerMsg *order, OrderClassStats *stats, bool wait) {
+    if (shm_ring_try_push(ring, order)) {
+        if (ring->wait == WAIT_FUTEX) {
+            wakeup_notify_one(&ring->not_empty);
+        }
+        return 0;
+    }
+    if (!wait) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if (stats != NULL) {
+        atomic_fetch_add_explicit(&stats->stalls, 1, memory_order_relaxed);
+    }
+    return shm_ring_push(ring, order, NULL);
+}
+
+// Put an order on the message queue, counting a stall if msg_qbytes was reached (EAGAIN unless wait)
+static int send_order_message(const CustomerMsg *order, OrderClassStats *stats, bool wait) {
+    if (order_wire_send(order_msgq_id, order, IPC_NOWAIT) == 0) {
+        return 0;
+    }
+    if (errno != EAGAIN || !wait) {
+        return -1;
+    }
+
+    if (stats != NULL) {
+        atomic_fetch_add_explicit(&stats->stalls, 1, memory_order_relaxed);
+    }
+    return order_wire_send(order_msgq_id, order, 0);
+}
+
+// Take the next order message (flags as for msgrcv), skipping malformed ones
+static int receive_order_message(CustomerMsg *msg, int flags) {
+    while (1) {
+        // A negative type takes the lowest type up to MSG_SIMULATION_END
+        if (order_wire_receive(order_msgq_id, msg, -MSG_SIMULATION_END, flags) == 0) {
+            return 0;
+        }
+        if (errno != EBADMSG) {
+            return -1;
+        }
+        perror("Order transport: Dropping malformed order");
+    }
+}
+
+// Create one ring in its own region
+static int create_ring(int index, const char *name, BakeryConfig config) {
+    uint32_t capacity = shm_ring_round_capacity(config.order_ring_slots);
+
+    order_ring_shm_ids[index] = shm_region_create(name, IPC_PRIVATE,
+                                                  shm_ring_size(capacity, sizeof(CustomerMsg)),
+                                                  (void **) &order_rings[index]);
+    if (order_ring_shm_ids[index] == -1) {
+        return -1;
+    }
+
+    return shm_ring_init(order_rings[index], capacity, sizeof(CustomerMsg), config.order_ring_wait);
+}
+
+// Set up the configured transport
+int order_transport_create(BakeryConfig config, int customer_msgq_id) {
+    transport = config.order_transport;
+    priorities = config.order_priorities;
+    order_msgq_id = customer_msgq_id;
+
+    order_board_shm_id = shm_region_create("order_board", IPC_PRIVATE, sizeof(OrderBoard),
+                                           (void **) &order_board);
+    if (order_board_shm_id == -1) {
+        return -1;
+    }
+
+    if (transport != ORDER_TRANSPORT_RING) {
+        return 0;
+    }
+
+    char name[32];
+    int wanted = priorities ? ORDER_CLASS_COUNT : 1;
+    ring_wait = config.order_ring_wait;
+
+    for (num_rings = 0; num_rings < wanted; num_rings++) {
+        if (priorities) {
+            snprintf(name, sizeof(name), "orders_%s", class_names[num_rings]);
+        } else {
+            snprintf(name, sizeof(name), "orders");
+        }
+
+        if (create_ring(num_rings, name, config) == -1) {
+            int saved_errno = errno;
+            num_rings++;
+            order_transport_destroy();
+            errno = saved_errno;
+            return -1;
+        }
+    }
+
+    printf("Orders travel through %d %u-slot shared memory ring(s) (%s wait)\n", num_rings,
+           order_rings[0]->capacity, wait_strategy_name(config.order_ring_wait));
+    return 0;
+}
+
+// Send an order to the sellers; if the channel is full wait, or fail with EAGAIN
+static int send_order(const CustomerMsg *msg, bool wait) {
+    CustomerMsg order = *msg;
+    OrderClassStats *stats = class_stats(&order);
+    int rc;
+
+    order.msg_type = message_type(msg);
+    order.enqueued_ns = histogram_now_ns();
+
+    if (stats != NULL) {
+        record_enqueue(stats);
+    }
+
+    if (transport == ORDER_TRANSPORT_RING) {
+        rc = push_order(ring_for(&order), &order, stats, wait);
+
+        // Sellers watching several rings sleep on the board
+        if (rc == 0 && num_rings > 1 && ring_wait == WAIT_FUTEX) {
+            wakeup_notify_one(&order_board->pending);
+        }
+    } else {
+        rc = send_order_message(&order, stats, wait);
+    }
+
+    if (rc == -1 && stats != NULL) {
+        atomic_fetch_sub_explicit(&stats->depth, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&stats->sent, 1, memory_order_relaxed);
+    }
+    return rc;
+}
+
+// Send an order (or complaint, or end message) to the sellers, waiting if the channel is full
+int order_send(const CustomerMsg *msg) {
+    return send_order(msg, true);
+}
+
+// Send an order only if the channel has room; -1 with errno EAGAIN if it is full
+int order_try_send(const CustomerMsg *msg) {
+    return send_order(msg, false);
+}
+
+// Wait for the next order. Queued orders come before the end message (the most
+// urgent class first when priorities are on); responses (type >= MSG_CUSTOMER_RESPONSE_BASE)
+// are never taken
+int order_receive(CustomerMsg *msg) {
+    if (transport == ORDER_TRANSPORT_RING) {
+        int rc = num_rings > 1
+                 ? shm_ring_pop_first(order_rings, num_rings, &order_board->pending, msg, NULL)
+                 : shm_ring_pop(order_rings[0], msg, NULL);
+        if (rc == -1) {
+            return -1;
+        }
+    } else if (receive_order_message(msg, 0) == -1) {
+        return -1;
+    }
+
+    record_dequeue(msg);
+    return 0;
+}
+
+// Take the next order only if one is already waiting; -1 with errno EAGAIN otherwise
+int order_try_receive(CustomerMsg *msg) {
+    if (transport == ORDER_TRANSPORT_RING) {
+        bool popped = false;
+
+        for (int i = 0; i < num_rings && !popped; i++) {
+            popped = shm_ring_try_pop(order_rings[i], msg);
+
+            if (popped && ring_wait == WAIT_FUTEX) {
+                wakeup_notify_one(&order_rings[i]->not_full);
+            }
+        }
+        if (!popped) {
+            errno = EAGAIN;
+            return -1;
+        }
+    } else if (receive_order_message(msg, IPC_NOWAIT) == -1) {
+        if (errno == ENOMSG) {
+            errno = EAGAIN;
+        }
+        return -1;
+    }
+
+    record_dequeue(msg);
+    return 0;
+}
+
+// Hand out a request ID no other order of this run carries
+uint64_t order_new_request_id(void) {
+    return atomic_fetch_add_explicit(&order_board->next_request_id, 1, memory_order_relaxed) + 1;
+}
+
+// True once the customer who placed an order has stopped waiting for it
+bool order_expired(const CustomerMsg *msg) {
+    return msg->deadline_ns != 0 && histogram_now_ns() >= msg->deadline_ns;
+}
+
+// Print queue depth and queueing latency per order class (used by the summary)
+void order_transport_print(void) {
+    if (order_board == NULL) {
+        return;
+    }
+
+    printf("Order classes (%s, times in us, percentiles are bucket upper bounds):\n",
+           priorities ? "served by priority" : "served FIFO");
+    printf("  %-10s %8s %8s %6s %9s %7s %9s %8s\n",
+           "class", "sent", "received", "depth", "max depth", "stalls", "wait avg", "wait p99");
+
+    for (int i = 0; i < ORDER_CLASS_COUNT; i++) {
+        OrderClassStats *stats = &order_board->classes[i];
+        unsigned long received = atomic_load_explicit(&stats->received, memory_order_relaxed);
+        unsigned long long wait_ns = atomic_load_explicit(&stats->wait_ns, memory_order_relaxed);
+
+        printf("  %-10s %8lu %8lu %6d %9d %7lu %9llu %8lu\n", class_names[i],
+               atomic_load_explicit(&stats->sent, memory_order_relaxed), received,
+               atomic_load_explicit(&stats->depth, memory_order_relaxed),
+               atomic_load_explicit(&stats->max_depth, memory_order_relaxed),
+               atomic_load_explicit(&stats->stalls, memory_order_relaxed),
+               wait_ns / 1000 / (received > 0 ? received : 1),
+               histogram_percentile_us(stats->wait_hist, received, 99));
+    }
+}
+
+// Remove the rings and the board (the message queue is removed with the other queues)
+void order_transport_destroy(void) {
+    for (int i = 0; i < num_rings; i++) {
+        if (order_ring_shm_ids[i] != -1) {
+            shm_region_destroy(order_ring_shm_ids[i]);
+            order_ring_shm_ids[i] = -1;
+        }
+        order_rings[i] = NULL;
+    }
+    num_rings = 0;
+
+    if (order_board_shm_id != -1) {
+        shm_region_destroy(order_board_shm_id);
+        order_board_shm_id = -1;
+        order_board = NULL;
+    }
+}
+
+// Parse a transport name from the config file
+OrderTransportType parse_order_transport(const char *name) {
+    if (strncmp(name, "ring", 4) == 0) {
+        return ORDER_TRANSPORT_RING;
+    } else if (strncmp(name, "msgq", 4) != 0) {
+        fprintf(stderr, "Unknown order transport '%s', using msgq\n", name);
+    }
+    return ORDER_TRANSPORT_MSGQ;
+}
+
+// Human readable transport name for logging
+const char *order_transport_name(OrderTransportType type) {
+    const char *names[] = {"msgq", "ring"};
+
+    if (type < 0 || type >= ORDER_TRANSPORT_COUNT) {
+        return "unknown";
+    }
+    return names[type];
+}
@@ -0,0 +1,100 @@
+#include "../include/order_wire.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+
+// Encode msg; returns the payload size to pass to msgsnd, or 0 if a field does not fit
+static size_t pack(const CustomerMsg *msg, OrderWire *wire) {
+    if (msg->num_lines < 0 || msg->num_lines > MAX_BASKET_LINES) {
+        return 0;
+    }
+
+    wire->msg_type = msg->msg_type;
+    wire->customer_id = msg->customer_id;
+    wire->request_id = msg->request_id;
+    wire->deadline_ns = msg->deadline_ns;
+    wire->enqueued_ns = msg->enqueued_ns;
+    wire->reply_slot = msg->reply_slot;
+    wire->reply_seq = msg->reply_seq;
+    wire->order_class = (uint8_t) msg->order_class;
+    wire->fulfilled = msg->fulfilled;
+    wire->num_lines = (uint8_t) msg->num_lines;
+
+    for (int i = 0; i < msg->num_lines; i++) {
+        const BasketLine *line = &msg->lines[i];
+
+        if (line->subtype < 0 || line->subtype > UINT8_MAX ||
+            line->quantity < 0 || line->quantity > UINT8_MAX) {
+            return 0;
+        }
+
+        wire->lines[i].product_type = (uint8_t) line->product_type;
+        wire->lines[i].subtype = (uint8_t) line->subtype;
+        wire->lines[i].quantity = (uint8_t) line->quantity;
+        wire->lines[i].fulfilled = line->fulfilled;
+    }
+
+    return offsetof(OrderWire, lines) - sizeof(long) + msg->num_lines * sizeof(WireLine);
+}
+
+// Decode a received payload of payload_size bytes; false if it is malformed
+static bool unpack(const OrderWire *wire, size_t payload_size, CustomerMsg *msg) {
+    size_t header = offsetof(OrderWire, lines) - sizeof(long);
+
+    if (payload_size < header || wire->num_lines > MAX_BASKET_LINES ||
+        payload_size != header + wire->num_lines * sizeof(WireLine)) {
+        return false;
+    }
+
+    memset(msg, 0, sizeof(CustomerMsg));
+    msg->msg_type = wire->msg_type;
+    msg->customer_id = wire->customer_id;
+    msg->request_id = wire->request_id;
+    msg->deadline_ns = wire->deadline_ns;
+    msg->enqueued_ns = wire->enqueued_ns;
+    msg->reply_slot = wire->reply_slot;
+    msg->reply_seq = wire->reply_seq;
+    msg->order_class = (OrderClass) wire->order_class;
+    msg->fulfilled = wire->fulfilled;
+    msg->num_lines = wire->num_lines;
+
+    for (int i = 0; i < msg->num_lines; i++) {
+        msg->lines[i].product_type = (ProductType) wire->lines[i].product_type;
+        msg->lines[i].subtype = wire->lines[i].subtype;
+        msg->lines[i].quantity = wire->lines[i].quantity;
+        msg->lines[i].fulfilled = wire->lines[i].fulfilled;
+    }
+
+    return true;
+}
+
+// Pack msg and put it on the queue (flags as for msgsnd)
+int order_wire_send(int msgq_id, const CustomerMsg *msg, int flags) {
+    OrderWire wire;
+    size_t payload_size = pack(msg, &wire);
+
+    if (payload_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return msgsnd(msgq_id, &wire, payload_size, flags);
+}
+
+// Take a message of msg_type (as for msgrcv) off the queue and unpack it into msg
+int order_wire_receive(int msgq_id, CustomerMsg *msg, long msg_type, int flags) {
+    OrderWire wire;
+    ssize_t payload_size = msgrcv(msgq_id, &wire, ORDER_WIRE_MAX_PAYLOAD, msg_type, flags);
+
+    if (payload_size == -1) {
+        return -1;
+    }
+
+    if (!unpack(&wire, (size_t) payload_size, msg)) {
+        errno = EBADMSG;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "../include/popularity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+// Products customers can buy (paste is the last product type and only used by chefs)
+#define SELLABLE_PRODUCT_COUNT PRODUCT_PASTE
+
+// Built by the parent before forking; read-only afterwards, so customer
+// processes, pool workers and engine threads share them without locking
+static AliasTable product_table;
+static AliasTable subtype_tables[PRODUCT_TYPE_COUNT];
+
+// Fill weights with the preset for count choices
+static void preset_weights(PopularityModel model, double exponent, double *weights, int count) {
+    for (int i = 0; i < count; i++) {
+        weights[i] = model == POPULARITY_ZIPF ? 1.0 / pow(i + 1, exponent) : 1.0;
+    }
+}
+
+// Build an alias table over count weights (Vose's method)
+static int build_alias_table(AliasTable *table, double *weights, int count, const char *what) {
+    double total = 0.0;
+
+    for (int i = 0; i < count; i++) {
+        total += weights[i];
+    }
+    if (total <= 0.0) {
+        fprintf(stderr, "%s weights are all zero, using uniform\n", what);
+        preset_weights(POPULARITY_UNIFORM, 0.0, weights, count);
+        total = count;
+    }
+
+    table->keep = malloc(count * sizeof(double));
+    table->alias = malloc(count * sizeof(int));
+    int *small = malloc(count * sizeof(int));
+    int *large = malloc(count * sizeof(int));
+    if (table->keep == NULL || table->alias == NULL || small == NULL || large == NULL) {
+        free(small);
+        free(large);
+        errno = ENOMEM;
+        return -1;
+    }
+    table->size = count;
+
+    // Scale so the average column holds 1, then pair each short column with a tall one
+    int num_small = 0, num_large = 0;
+    for (int i = 0; i < count; i++) {
+        table->keep[i] = weights[i] * count / total;
+        table->alias[i] = i;
+        if (table->keep[i] < 1.0) {
+            small[num_small++] = i;
+        } else {
+            large[num_large++] = i;
+        }
+    }
+
+    while (num_small > 0 && num_large > 0) {
+        int short_column = small[--num_small];
+        int tall_column = large[--num_large];
+
+        table->alias[short_column] = tall_column;
+        table->keep[tall_column] -= 1.0 - table->keep[short_column];
+        if (table->keep[tall_column] < 1.0) {
+            small[num_small++] = tall_column;
+        } else {
+            large[num_large++] = tall_column;
+        }
+    }
+
+    // Whatever is left is full up to rounding error
+    while (num_small > 0) {
+        table->keep[small[--num_small]] = 1.0;
+    }
+    while (num_large > 0) {
+        table->keep[large[--num_large]] = 1.0;
+    }
+
+    free(small);
+    free(large);
+    return 0;
+}
+
+// Draw one choice in constant time
+static int alias_sample(const AliasTable *table) {
+    int column = rand() % table->size;
+    return (double) rand() / ((double) RAND_MAX + 1.0) < table->keep[column]
+           ? column : table->alias[column];
+}
+
+// Share of choice i, recovered from the table for logging
+static double alias_share(const AliasTable *table, int choice) {
+    double share = table->keep[choice];
+
+    for (int i = 0; i < table->size; i++) {
+        if (table->alias[i] == choice && i != choice) {
+            share += 1.0 - table->keep[i];
+        }
+    }
+    return share / table->size;
+}
+
+// Build the product and subtype tables (called by the parent)
+int popularity_create(BakeryConfig config) {
+    const char *product_names[] = {"Bread", "Sandwich", "Cake", "Sweet",
+                                   "Sweet Patisserie", "Savory Patisserie"};
+    double weights[SELLABLE_PRODUCT_COUNT];
+
+    if (config.num_product_weights > 0) {
+        memcpy(weights, config.product_weights, sizeof(double) * SELLABLE_PRODUCT_COUNT);
+    } else {
+        preset_weights(config.product_popularity, config.zipf_exponent, weights,
+                       SELLABLE_PRODUCT_COUNT);
+    }
+    if (build_alias_table(&product_table, weights, SELLABLE_PRODUCT_COUNT, "Product") == -1) {
+        return -1;
+    }
+
+    printf("Product popularity (%s):", config.num_product_weights > 0 ? "weights"
+           : popularity_model_name(config.product_popularity));
+    for (int i = 0; i < SELLABLE_PRODUCT_COUNT; i++) {
+        printf(" %s %.1f%%%s", product_names[i], 100.0 * alias_share(&product_table, i),
+               i + 1 < SELLABLE_PRODUCT_COUNT ? "," : "\n");
+    }
+
+    for (int type = 0; type < SELLABLE_PRODUCT_COUNT; type++) {
+        int count = config.num_categories[type];
+        if (count <= 0) {
+            continue;
+        }
+
+        double *subtype_weights = malloc(count * sizeof(double));
+        if (subtype_weights == NULL) {
+            popularity_destroy();
+            errno = ENOMEM;
+            return -1;
+        }
+
+        if (config.num_subtype_weights[type] > 0) {
+            for (int i = 0; i < count; i++) {
+                subtype_weights[i] = i < config.num_subtype_weights[type]
+                                     ? config.subtype_weights[type][i] : 0.0;
+            }
+        } else {
+            preset_weights(config.subtype_popularity, config.zipf_exponent, subtype_weights, count);
+        }
+
+        if (build_alias_table(&subtype_tables[type], subtype_weights, count,
+                              product_names[type]) == -1) {
+            int saved_errno = errno;
+            free(subtype_weights);
+            popularity_destroy();
+            errno = saved_errno;
+            return -1;
+        }
+        free(subtype_weights);
+
+        // Uniform subtypes are the old behaviour and not worth a line each
+        if (config.num_subtype_weights[type] > 0 || config.subtype_popularity != POPULARITY_UNIFORM) {
+            printf("  %s subtypes:", product_names[type]);
+            for (int i = 0; i < count; i++) {
+                printf(" %.1f%%", 100.0 * alias_share(&subtype_tables[type], i));
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
+
+// Product of the next basket line
+ProductType popularity_pick_product(void) {
+    return (ProductType) alias_sample(&product_table);
+}
+
+// Subtype (flavor, variety) of the next basket line; 0 for products without subtypes
+int popularity_pick_subtype(ProductType type) {
+    if (subtype_tables[type].size == 0) {
+        return 0;
+    }
+    return alias_sample(&subtype_tables[type]);
+}
+
+// Free the tables
+void popularity_destroy(void) {
+    AliasTable *tables[PRODUCT_TYPE_COUNT + 1] = {&product_table};
+
+    for (int type = 0; type < PRODUCT_TYPE_COUNT; type++) {
+        tables[type + 1] = &subtype_tables[type];
+    }
+
+    for (int i = 0; i < PRODUCT_TYPE_COUNT + 1; i++) {
+        free(tables[i]->keep);
+        free(tables[i]->alias);
+        memset(tables[i], 0, sizeof(AliasTable));
+    }
+}
+
+// Parse a popularity preset name from the config file
+PopularityModel parse_popularity_model(const char *name) {
+    if (strncmp(name, "zipf", 4) == 0) {
+        return POPULARITY_ZIPF;
+    } else if (strncmp(name, "uniform", 7) != 0) {
+        fprintf(stderr, "Unknown popularity model '%s', using uniform\n", name);
+    }
+    return POPULARITY_UNIFORM;
+}
+
+// Human readable popularity preset name for logging
+const char *popularity_model_name(PopularityModel model) {
+    const char *names[] = {"uniform", "zipf"};
+
+    if (model < 0 || model >= POPULARITY_MODEL_COUNT) {
+        return "unknown";
+    }
+    return names[model];
+}
+
+// Parse a comma separated weight list; returns how many weights were read
+int parse_popularity_weights(const char *value, double *weights, int max_weights) {
+    int count = 0;
+    const char *cursor = value;
+
+    while (count < max_weights && *cursor != '\0') {
+        char *end;
+        double weight = strtod(cursor, &end);
+
+        if (end == cursor || weight < 0.0) {
+            fprintf(stderr, "Bad popularity weight in '%s', ignoring the rest\n", value);
+            break;
+        }
+        weights[count++] = weight;
+
+        while (*end == ' ' || *end == '\t') {
+            end++;
+        }
+        if (*end != ',') {
+            break;
+        }
+        cursor = end + 1;
+    }
+
+    return count;
+}
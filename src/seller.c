@@ -1,6 +1,14 @@
 #include "../include/seller.h"
+#include "../include/counters.h"
+#include "../include/stats.h"
+#include "../include/wip_ledger.h"
+#include "../include/order_transport.h"
+#include "../include/mailbox.h"
+#include "../include/order_heap.h"
+#include "../include/order_wire.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
 #include <time.h>
 #include <sys/types.h>
@@ -12,10 +20,10 @@
 // Handle a customer complaint
 void handle_customer_complaint(CustomerMsg *complaint, ProductionStatus *status) {
     printf("Processing complaint from customer %d about product %d\n", 
-           complaint->customer_id, complaint->product_type);
+           complaint->customer_id, complaint->lines[0].product_type);
     
-    // Increment the complaints counter in the production status
-    status->complained_customers++;
+    // Increment the complaints counter in this seller's statistics shard
+    counter_add(&stats_local()->complained_customers, 1);
     
     // In a real system, we might:
     // 1. Log the complaint
@@ -33,7 +41,14 @@ void handle_customer_complaint(CustomerMsg *complaint, ProductionStatus *status)
 bool check_product_availability(ProductType type, int subtype, int quantity, 
                               ProductionStatus *status) {
     // Check if we have enough of this product type available
-    int available = status->produced_items[type] - status->sold_items[type];
+    // (paste and bread are shared with the chefs, so only unreserved units count)
+    int available;
+    WipItem wip_item;
+    if (wip_item_for_product(type, &wip_item)) {
+        available = wip_available(&status->wip, wip_item);
+    } else {
+        available = counter_read(&status->produced_items[type]) - counter_read(&status->sold_items[type]);
+    }
     
     // Add some constraint logic to simulate limited inventory
     // For certain products, enforce stricter availability constraints
@@ -53,129 +68,352 @@ bool check_product_availability(ProductType type, int subtype, int quantity,
     return (available >= quantity);
 }
 
-// Handle a customer request
-void handle_customer_request(CustomerMsg *request, ProductionStatus *status, 
-                           BakeryConfig config, int *customers_served) {
-    
+// Sell one basket line if the product is available; returns true if it was fulfilled
+static bool sell_basket_line(int customer_id, BasketLine *line, ProductionStatus *status,
+                             BakeryConfig config) {
     printf("Processing request from customer %d for product %d (subtype %d)\n",
-           request->customer_id, request->product_type, request->subtype);
+           customer_id, line->product_type, line->subtype);
     
     // Check if the requested product is available
-    bool available = check_product_availability(request->product_type, 
-                                             request->subtype,
-                                             request->quantity, status);
+    bool available = check_product_availability(line->product_type, line->subtype,
+                                                 line->quantity, status);
+    
+    // Claim paste or bread in the ledger so a chef cannot take the same units
+    WipItem wip_item;
+    bool uses_wip = wip_item_for_product(line->product_type, &wip_item);
+    if (available && uses_wip) {
+        available = wip_reserve(&status->wip, wip_item, line->quantity);
+    }
+    
+    line->fulfilled = available;
     
     if (!available) {
         // Product not available
         printf("Product %d not available for customer %d\n", 
-               request->product_type, request->customer_id);
+               line->product_type, customer_id);
         
         // Increment missing items counter
-        status->missing_items_requests++;
+        counter_add(&stats_local()->missing_items_requests, 1);
+        return false;
+    }
+    
+    if (uses_wip) {
+        wip_commit(&status->wip, wip_item, line->quantity);
+    }
+    
+    // Update the production status
+    seqlock_write_begin(stats_seqlock(STATS_SEQ_STATUS));
+    counter_add(&status->sold_items[line->product_type], line->quantity);
+    seqlock_write_end(stats_seqlock(STATS_SEQ_STATUS));
+    
+    // Per-subtype sales live in the shared arena, sized by the configured categories
+    _Atomic int *subtype_sold = shm_arena_ptr(shm_arena_local(),
+                                              status->subtype_sold[line->product_type]);
+    if (subtype_sold != NULL && line->subtype >= 0 &&
+        line->subtype < config.num_categories[line->product_type]) {
+        counter_add(&subtype_sold[line->subtype], line->quantity);
+    }
+    
+    // Calculate and record the profit in this seller's statistics shard
+    double price = config.product_prices[line->product_type];
+    double sale_profit = price * line->quantity;
+    profit_add(&stats_local()->total_profit, sale_profit);
+    counter_add(&stats_local()->items_handled, line->quantity);
+    
+    return true;
+}
+
+// Handle a customer request: fill every line of the basket (the caller holds the
+// production lock once for the whole basket) and record the per-line results
+void handle_customer_request(CustomerMsg *request, ProductionStatus *status, 
+                           BakeryConfig config, int *customers_served) {
+    int lines_fulfilled = 0;
+    
+    for (int i = 0; i < request->num_lines && i < MAX_BASKET_LINES; i++) {
+        if (sell_basket_line(request->customer_id, &request->lines[i], status, config)) {
+            lines_fulfilled++;
+        }
+    }
+    
+    request->fulfilled = (lines_fulfilled == request->num_lines);
+    
+    if (lines_fulfilled > 0) {
+        // Count this as a successful transaction
+        (*customers_served)++;
         
-        // Set failure in response
-        request->fulfilled = false;
-        // Removed the early return so we still send a response
-    } else {
-        // Product is available - fulfill the request
-        request->fulfilled = true;
+        printf("Order for customer %d fulfilled (%d of %d lines)\n",
+               request->customer_id, lines_fulfilled, request->num_lines);
+    }
+    
+    // A response is always sent, whether the products were available or not
+}
+
+// Skip an order whose customer has already left; true if it was skipped
+static bool skip_if_expired(const CustomerMsg *order) {
+    if (order->order_class == ORDER_CLASS_COMPLAINT || !order_expired(order)) {
+        return false;
+    }
+    
+    printf("Skipping order %llu from customer %d, who already left\n",
+           (unsigned long long) order->request_id, order->customer_id);
+    counter_add(&stats_local()->expired_orders, 1);
+    return true;
+}
+
+// Block until an order arrives; 0 on success, -1 with errno set (EINTR, or the channel is gone)
+static int wait_for_order(CustomerMsg *order) {
+    if (order_receive(order) == -1) {
+        // The queue was removed (EIDRM) or is unusable, nothing left to serve
+        if (errno != EINTR && errno != EIDRM) {
+            perror("Seller: Failed to receive customer message");
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// Fill batch in arrival order: block for the first order, then take whatever else is
+// already waiting. Returns the number of orders, or -1 if the channel is gone
+static int collect_fifo_batch(CustomerMsg *batch, int batch_size, bool *end_received) {
+    CustomerMsg customer_msg;
+    int num_orders = 0;
+    
+    // Block until a request or the end-of-simulation message arrives
+    // (queued requests are served before the end message)
+    if (wait_for_order(&customer_msg) == -1) {
+        return errno == EINTR ? 0 : -1;
+    }
+    
+    while (1) {
+        if (customer_msg.msg_type == MSG_SIMULATION_END) {
+            // Management sends one of these per seller
+            *end_received = true;
+            break;
+        }
         
-        // Update the production status
-        status->sold_items[request->product_type] += request->quantity;
+        // Anything else order_receive returns is an order of some class
+        batch[num_orders++] = customer_msg;
         
-        // Calculate and update profit
-        double price = config.product_prices[request->product_type];
-        double sale_profit = price * request->quantity;
-        status->total_profit += sale_profit;
+        // An empty channel (or an error, seen again by the next blocking receive) ends the batch
+        if (num_orders == batch_size || order_try_receive(&customer_msg) == -1) {
+            break;
+        }
+    }
+    
+    return num_orders;
+}
+
+// Set once this seller took its end message while scheduling by deadline
+static bool end_pending = false;
+
+// Fill batch with the orders closest to their deadline: move everything waiting in the
+// transport into the shared heap, then take the most urgent ones. When neither holds an
+// order, one idle seller blocks on the transport and the others sleep until an order is
+// pushed into the heap (or they may take over the transport). An end message is kept by
+// the seller that received it (so every seller still gets exactly one) and takes effect
+// once the heap is empty. Returns the number of orders, or -1 if the channel is gone
+static int collect_edf_batch(CustomerMsg *batch, int batch_size, bool *end_received) {
+    CustomerMsg customer_msg;
+    
+    while (1) {
+        while (!end_pending && !order_heap_full() && order_try_receive(&customer_msg) == 0) {
+            if (customer_msg.msg_type == MSG_SIMULATION_END) {
+                end_pending = true;
+            } else if (order_heap_push(&customer_msg) == -1) {
+                perror("Seller: Failed to queue order for scheduling");
+                batch[0] = customer_msg;
+                return 1;
+            }
+        }
         
-        // Count this as a successful transaction
-        (*customers_served)++;
+        int num_orders = 0;
+        while (num_orders < batch_size && order_heap_pop(&batch[num_orders]) == 0) {
+            num_orders++;
+        }
+        
+        if (num_orders > 0 || end_pending) {
+            *end_received = (num_orders == 0);
+            return num_orders;
+        }
+        
+        // Nothing to serve anywhere. Orders pushed from now on bump the channel, so one
+        // that arrives before we sleep is not missed
+        unsigned int seen = order_heap_prepare_wait();
+        if (!order_heap_empty()) {
+            continue;
+        }
+        
+        if (!order_heap_claim_receiver()) {
+            // Another seller watches the transport; back to the main loop after waking
+            order_heap_wait(seen);
+            return 0;
+        }
         
-        // Simulate the time it takes to package and hand over the product
-        int service_time = 500 + (rand() % 1000);  // 0.5-1.5 seconds
-        usleep(service_time * 1000);
+        // Wait for the next order and schedule it like the rest
+        int rc = wait_for_order(&customer_msg);
+        int saved_errno = errno;
+        order_heap_release_receiver();
+        if (rc == -1) {
+            return saved_errno == EINTR ? 0 : -1;
+        }
         
-        printf("Order for customer %d fulfilled\n", request->customer_id);
+        if (customer_msg.msg_type == MSG_SIMULATION_END) {
+            end_pending = true;
+        } else if (order_heap_push(&customer_msg) == -1) {
+            perror("Seller: Failed to queue order for scheduling");
+            batch[0] = customer_msg;
+            return 1;
+        }
+    }
+}
+
+// Answer an order without selling anything (the production status could not be locked)
+static void refuse_order(CustomerMsg *request) {
+    for (int i = 0; i < request->num_lines && i < MAX_BASKET_LINES; i++) {
+        request->lines[i].fulfilled = false;
+    }
+    request->fulfilled = false;
+}
+
+// True if any line of the order was sold, so there is something to package
+static bool order_has_sales(const CustomerMsg *request) {
+    for (int i = 0; i < request->num_lines && i < MAX_BASKET_LINES; i++) {
+        if (request->lines[i].fulfilled) {
+            return true;
+        }
     }
+    return false;
+}
+
+// Hand the response to the customer (runs after the production lock is released)
+static void hand_over_order(CustomerMsg *request, int customer_msgq_id) {
+    // Prepare response - use customer ID + response base for message type
+    CustomerMsg response_msg = *request;
+    response_msg.msg_type = request->customer_id + MSG_CUSTOMER_RESPONSE_BASE;
     
-    // Now we always send a response, whether the product was available or not
+    // Send response back to customer, straight into its mailbox if it has one
+    // (a customer that already left simply does not get it)
+    if (request->reply_slot >= 0) {
+        mailbox_deliver(request->reply_slot, request->reply_seq, &response_msg);
+    } else if (order_wire_send(customer_msgq_id, &response_msg, 0) == -1) {
+        perror("Seller: Failed to send response to customer");
+    }
 }
 
 // Seller process main function
 void seller_process(int id, int customer_msgq_id, int prod_status_shm_id, 
-                   int prod_sem_id, BakeryConfig config) {
+                   BakeryConfig config) {
     
     // Attach to shared memory segment
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (status == (void *) -1) {
+    if (status == NULL) {
         perror("Seller: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Define semaphore operations
-    struct sembuf prod_lock = {0, -1, 0};
-    struct sembuf prod_unlock = {0, 1, 0};
-    
     // Track number of customers served
     int customers_served = 0;
     
+    stats_bind_worker(ROLE_SELLER, id);
+    
     printf("Seller %d started (PID: %d)\n", id, getpid());
     
+    // Up to SELLER_BATCH_SIZE orders are served per production lock hold
+    int batch_size = config.seller_batch_size > 1 ? config.seller_batch_size : 1;
+    CustomerMsg *batch = malloc(batch_size * sizeof(CustomerMsg));
+    if (batch == NULL) {
+        perror("Seller: Failed to allocate order batch");
+        exit(EXIT_FAILURE);
+    }
+    
+    bool end_received = false;
+    
     // Main processing loop
-    while (status->simulation_active) {
-        // Message buffer for customer requests
-        CustomerMsg customer_msg;
-        
-        // Try to receive a customer request message
-        ssize_t msg_size = msgrcv(customer_msgq_id, &customer_msg, sizeof(CustomerMsg) - sizeof(long),
-                                 MSG_CUSTOMER_REQUEST, IPC_NOWAIT);
-        
-        if (msg_size == -1) {
-            // No message, wait a bit
-            usleep(100000);  // 100ms
-            continue;
+    while (status->simulation_active && !end_received) {
+        // Next orders to serve, in arrival order or earliest deadline first
+        int num_orders = order_heap_enabled()
+                         ? collect_edf_batch(batch, batch_size, &end_received)
+                         : collect_fifo_batch(batch, batch_size, &end_received);
+        if (num_orders == -1) {
+            break;
         }
         
-        // Lock production status to check availability
-        if (semop(prod_sem_id, &prod_lock, 1) == -1) {
-            perror("Seller: Failed to lock production status semaphore");
-            continue;
+        // Orders that waited past their deadline are dropped right away
+        int num_requests = 0;
+        int kept = 0;
+        for (int i = 0; i < num_orders; i++) {
+            if (skip_if_expired(&batch[i])) {
+                continue;
+            }
+            if (batch[i].order_class != ORDER_CLASS_COMPLAINT) {
+                num_requests++;
+            }
+            batch[kept++] = batch[i];
         }
+        num_orders = kept;
         
-        if (customer_msg.is_complaint) {
-            // Handle the complaint
-            handle_customer_complaint(&customer_msg, status);
-            
-            // Unlock production status after handling complaint
-            if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
-                perror("Seller: Failed to unlock production status semaphore");
+        if (num_requests > 0) {
+            // Lock production status once to check and commit every basket of the batch;
+            // without the lock the orders are still answered, as not fulfilled
+            bool locked = bakery_lock_acquire(&status->lock) == 0;
+            if (!locked) {
+                perror("Seller: Failed to lock production status semaphore");
             }
-        } else {
-            // Handle the customer request
-            handle_customer_request(&customer_msg, status, config, &customers_served);
             
-            // Prepare response - use customer ID + response base for message type
-            CustomerMsg response_msg = customer_msg;
-            response_msg.msg_type = customer_msg.customer_id + MSG_CUSTOMER_RESPONSE_BASE;
+            // Check the deadlines again (the lock may have taken a while) and keep only
+            // the orders that are still wanted
+            kept = 0;
+            for (int i = 0; i < num_orders; i++) {
+                if (skip_if_expired(&batch[i])) {
+                    num_requests--;
+                    continue;
+                }
+                
+                if (batch[i].order_class != ORDER_CLASS_COMPLAINT) {
+                    if (locked) {
+                        handle_customer_request(&batch[i], status, config, &customers_served);
+                    } else {
+                        refuse_order(&batch[i]);
+                    }
+                }
+                batch[kept++] = batch[i];
+            }
+            num_orders = kept;
             
-            // Unlock production status before sending response
-            if (semop(prod_sem_id, &prod_unlock, 1) == -1) {
+            // Unlock production status before sending responses
+            if (locked && bakery_lock_release(&status->lock) == -1) {
                 perror("Seller: Failed to unlock production status semaphore");
             }
             
-            // Send response back to customer
-            if (msgsnd(customer_msgq_id, &response_msg, sizeof(CustomerMsg) - sizeof(long), 0) == -1) {
-                perror("Seller: Failed to send response to customer");
+            if (locked && num_requests > 0) {
+                stats_record_batch(num_requests);
             }
         }
         
-        // We've already unlocked in both branches, so no need to unlock here
+        // Responses and complaints are handled outside the lock
+        for (int i = 0; i < num_orders; i++) {
+            if (batch[i].order_class == ORDER_CLASS_COMPLAINT) {
+                // Complaints only touch this seller's statistics shard, so no lock is needed
+                handle_customer_complaint(&batch[i], status);
+                continue;
+            }
+            
+            // Every basket with sales takes its own time to package, and its customer is
+            // answered as soon as it is ready rather than after the whole batch
+            if (order_has_sales(&batch[i])) {
+                int service_time = 500 + (rand() % 1000);  // 0.5-1.5 seconds
+                usleep(service_time * 1000);
+            }
+            hand_over_order(&batch[i], customer_msgq_id);
+        }
     }
     
+    free(batch);
+    
     printf("Seller %d terminating, served %d customers (PID: %d)\n", 
            id, customers_served, getpid());
     
     // Detach from shared memory
-    shmdt(status);
+    shm_region_detach(prod_status_shm_id, status);
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "../include/shm_arena.h"
+#include "../include/shm_region.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Tagged free list heads: the low bits hold the offset, the high bits a counter
+#define OFFSET_BITS 40
+#define OFFSET_MASK ((1ULL << OFFSET_BITS) - 1)
+
+// Every block starts with a header naming its size class; payloads stay 16-byte aligned
+#define BLOCK_HEADER_SIZE 16
+#define BLOCK_MAGIC 0xB10CB10Cu
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size_class;
+} BlockHeader;
+
+// Mapping of this process (attached by the parent before forking, so inherited)
+static ShmArena *local_arena = NULL;
+
+static uint64_t tag_offset(uint64_t head, uint64_t offset) {
+    return (((head >> OFFSET_BITS) + 1) << OFFSET_BITS) | offset;
+}
+
+// Smallest size class that fits size bytes, or -1
+static int size_class_of(size_t size) {
+    size_t block = SHM_ARENA_MIN_BLOCK;
+
+    for (int i = 0; i < SHM_ARENA_CLASSES; i++, block <<= 1) {
+        if (size <= block) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Header of the block holding a payload offset
+static BlockHeader *block_header(ShmArena *arena, ShmOffset offset) {
+    return (BlockHeader *) ((char *) arena + offset - BLOCK_HEADER_SIZE);
+}
+
+// Create the arena region, map it and set up the header; returns the region handle
+int shm_arena_create(size_t size) {
+    size_t header = (sizeof(ShmArena) + BLOCK_HEADER_SIZE - 1) & ~(size_t) (BLOCK_HEADER_SIZE - 1);
+
+    if (size <= header || size > OFFSET_MASK) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int handle = shm_region_create("arena", IPC_PRIVATE, size, (void **) &local_arena);
+    if (handle == -1) {
+        return -1;
+    }
+
+    // The region comes back zeroed, so the free lists start out empty
+    local_arena->size = size;
+    local_arena->data_start = header;
+    atomic_store_explicit(&local_arena->bump, header, memory_order_release);
+
+    return handle;
+}
+
+// Map the arena in the calling process; offsets stay valid at any address
+ShmArena *shm_arena_attach(int handle) {
+    ShmArena *arena = (ShmArena *) shm_region_attach(handle);
+
+    if (arena != NULL) {
+        local_arena = arena;
+    }
+    return arena;
+}
+
+// Arena mapping of the calling process (NULL if no arena was created)
+ShmArena *shm_arena_local(void) {
+    return local_arena;
+}
+
+// Allocate size bytes; returns SHM_NULL with errno set if the request is too
+// large (EINVAL) or the arena is exhausted (ENOMEM)
+ShmOffset shm_arena_alloc(ShmArena *arena, size_t size) {
+    int size_class = size_class_of(size);
+
+    if (arena == NULL || size_class == -1) {
+        errno = EINVAL;
+        return SHM_NULL;
+    }
+
+    // Fast path: pop a recycled block of the right class
+    _Atomic uint64_t *list = &arena->free_lists[size_class];
+    uint64_t head = atomic_load_explicit(list, memory_order_acquire);
+
+    while ((head & OFFSET_MASK) != SHM_NULL) {
+        ShmOffset offset = head & OFFSET_MASK;
+        // A free block keeps the offset of the next one in its payload. Another
+        // process may pop and reuse it while we read; the tag makes our CAS fail then.
+        uint64_t next = atomic_load_explicit((_Atomic uint64_t *) shm_arena_ptr(arena, offset),
+                                             memory_order_relaxed);
+
+        if (atomic_compare_exchange_weak_explicit(list, &head, tag_offset(head, next),
+                                                  memory_order_acquire, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&arena->live_blocks[size_class], 1, memory_order_relaxed);
+            return offset;
+        }
+    }
+
+    // Slow path: carve a fresh block from the untouched end of the region
+    uint64_t block_size = BLOCK_HEADER_SIZE + ((uint64_t) SHM_ARENA_MIN_BLOCK << size_class);
+    uint64_t start = atomic_fetch_add_explicit(&arena->bump, block_size, memory_order_relaxed);
+
+    if (start + block_size > arena->size) {
+        errno = ENOMEM;
+        return SHM_NULL;
+    }
+
+    BlockHeader *header = (BlockHeader *) ((char *) arena + start);
+    header->magic = BLOCK_MAGIC;
+    header->size_class = size_class;
+
+    atomic_fetch_add_explicit(&arena->live_blocks[size_class], 1, memory_order_relaxed);
+    return start + BLOCK_HEADER_SIZE;
+}
+
+// Allocate a zeroed array of count elements
+ShmOffset shm_arena_calloc(ShmArena *arena, size_t count, size_t size) {
+    if (size != 0 && count > SHM_ARENA_MAX_BLOCK / size) {
+        errno = EINVAL;
+        return SHM_NULL;
+    }
+
+    ShmOffset offset = shm_arena_alloc(arena, count * size);
+    if (offset != SHM_NULL) {
+        memset(shm_arena_ptr(arena, offset), 0, count * size);
+    }
+    return offset;
+}
+
+// Return a block to the free list of its size class
+void shm_arena_free(ShmArena *arena, ShmOffset offset) {
+    if (arena == NULL || offset == SHM_NULL) {
+        return;
+    }
+
+    BlockHeader *header = block_header(arena, offset);
+    if (header->magic != BLOCK_MAGIC || header->size_class >= SHM_ARENA_CLASSES) {
+        fprintf(stderr, "Arena: ignoring free of invalid offset %llu\n", (unsigned long long) offset);
+        return;
+    }
+
+    _Atomic uint64_t *list = &arena->free_lists[header->size_class];
+    _Atomic uint64_t *link = (_Atomic uint64_t *) shm_arena_ptr(arena, offset);
+    uint64_t head = atomic_load_explicit(list, memory_order_relaxed);
+
+    do {
+        atomic_store_explicit(link, head & OFFSET_MASK, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(list, &head, tag_offset(head, offset),
+                                                    memory_order_release, memory_order_relaxed));
+
+    atomic_fetch_sub_explicit(&arena->live_blocks[header->size_class], 1, memory_order_relaxed);
+}
+
+// Print arena usage (used by the summary)
+void shm_arena_print(ShmArena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    uint64_t used = atomic_load_explicit(&arena->bump, memory_order_relaxed);
+    if (used > arena->size) {
+        used = arena->size;
+    }
+
+    printf("Shared arena: %llu of %llu bytes carved\n",
+           (unsigned long long) (used - arena->data_start),
+           (unsigned long long) (arena->size - arena->data_start));
+    for (int i = 0; i < SHM_ARENA_CLASSES; i++) {
+        long live = atomic_load_explicit(&arena->live_blocks[i], memory_order_relaxed);
+        if (live != 0) {
+            printf("  %5d-byte blocks in use: %ld\n", SHM_ARENA_MIN_BLOCK << i, live);
+        }
+    }
+}
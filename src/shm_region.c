@@ -0,0 +1,264 @@
+#include "../include/shm_region.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+// Huge page size assumed when rounding POSIX regions (x86-64/aarch64 default)
+#define SHM_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+// One region created by the parent; the table is inherited by every forked process
+typedef struct {
+    bool in_use;
+    int shm_id;                 // SHM_BACKEND_SYSV
+    int fd;                     // SHM_BACKEND_POSIX
+    char path[SHM_HUGETLBFS_DIR_LEN + 64];  // SHM_BACKEND_POSIX object name or hugetlbfs file
+    size_t size;                // Mapped size (rounded up for huge pages)
+    void *addr;                 // The creator's mapping
+    bool hugetlbfs;             // Backed by a file on the hugetlbfs mount instead of /dev/shm
+} ShmRegion;
+
+static ShmOptions shm_options;
+static ShmRegion regions[SHM_REGION_MAX];
+
+// Map a POSIX region. Files on hugetlbfs are always backed by huge pages; /dev/shm is
+// tmpfs, where the most we can do is advise the kernel to use transparent huge pages
+static void *map_posix_region(ShmRegion *region) {
+    int flags = MAP_SHARED;
+
+    if (shm_options.prefault) {
+        flags |= MAP_POPULATE;
+    }
+
+    void *addr = mmap(NULL, region->size, PROT_READ | PROT_WRITE, flags, region->fd, 0);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (shm_options.huge_pages && !region->hugetlbfs) {
+        madvise(addr, region->size, MADV_HUGEPAGE);
+    }
+#endif
+
+    return addr;
+}
+
+// Open the file of a POSIX region, exclusively
+static int open_region_file(const ShmRegion *region) {
+    if (region->hugetlbfs) {
+        return open(region->path, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    return shm_open(region->path, O_CREAT | O_EXCL | O_RDWR, 0600);
+}
+
+// Remove the file of a POSIX region
+static void remove_region_file(const ShmRegion *region) {
+    if (region->hugetlbfs) {
+        unlink(region->path);
+    } else {
+        shm_unlink(region->path);
+    }
+}
+
+// Create, size and map the file of a POSIX region whose path is already set
+static int create_posix_region(ShmRegion *region) {
+    region->fd = open_region_file(region);
+    if (region->fd == -1 && errno == EEXIST) {
+        // Left behind by a crashed run with the same ID; never reuse its contents
+        fprintf(stderr, "Shared memory: removing stale %s\n", region->path);
+        remove_region_file(region);
+        region->fd = open_region_file(region);
+    }
+    if (region->fd == -1) {
+        return -1;
+    }
+
+    // A hugetlbfs mapping fails here, not on first touch, when too few huge pages are reserved
+    if (ftruncate(region->fd, region->size) == -1 ||
+        (region->addr = map_posix_region(region)) == NULL) {
+        int saved_errno = errno;
+        close(region->fd);
+        remove_region_file(region);
+        region->fd = -1;
+        errno = saved_errno;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Remember the options of this run (called once by the parent before creating regions)
+int shm_region_setup(const ShmOptions *options) {
+    // The run ID ends up in a file name, so keep it to a safe alphabet
+    for (const char *c = options->run_id; *c; c++) {
+        if (!isalnum((unsigned char) *c) && *c != '-' && *c != '_') {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    shm_options = *options;
+    memset(regions, 0, sizeof(regions));
+
+    // Only a hugetlbfs mount gives real huge pages; anything else would be a plain file
+    if (shm_options.huge_pages && shm_options.hugetlbfs_dir[0] != '\0') {
+        struct statfs fs;
+
+        if (statfs(shm_options.hugetlbfs_dir, &fs) == -1 || fs.f_type != HUGETLBFS_MAGIC) {
+            fprintf(stderr, "Shared memory: %s is not a hugetlbfs mount, using transparent huge pages\n",
+                    shm_options.hugetlbfs_dir);
+            shm_options.hugetlbfs_dir[0] = '\0';
+        }
+    }
+    return 0;
+}
+
+// Create a region, map it in the caller and zero it; returns its handle and,
+// in addr, the creator's mapping
+int shm_region_create(const char *name, key_t sysv_key, size_t size, void **addr) {
+    int handle = -1;
+
+    for (int i = 0; i < SHM_REGION_MAX; i++) {
+        if (!regions[i].in_use) {
+            handle = i;
+            break;
+        }
+    }
+
+    if (handle == -1) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    ShmRegion *region = &regions[handle];
+    memset(region, 0, sizeof(ShmRegion));
+    region->shm_id = -1;
+    region->fd = -1;
+    region->size = size;
+
+    if (shm_options.backend == SHM_BACKEND_SYSV) {
+        region->shm_id = shmget(sysv_key, size, IPC_CREAT | 0666);
+        if (region->shm_id == -1) {
+            return -1;
+        }
+
+        region->addr = shmat(region->shm_id, NULL, 0);
+        if (region->addr == (void *) -1) {
+            int saved_errno = errno;
+            shmctl(region->shm_id, IPC_RMID, NULL);
+            errno = saved_errno;
+            return -1;
+        }
+    } else {
+        if (shm_options.huge_pages) {
+            region->size = (size + SHM_HUGE_PAGE_SIZE - 1) & ~(SHM_HUGE_PAGE_SIZE - 1);
+        }
+
+        if (shm_options.huge_pages && shm_options.hugetlbfs_dir[0] != '\0') {
+            region->hugetlbfs = true;
+            snprintf(region->path, sizeof(region->path), "%s/bakery-%s-%s",
+                     shm_options.hugetlbfs_dir, shm_options.run_id, name);
+
+            if (create_posix_region(region) == -1) {
+                fprintf(stderr, "Shared memory: no huge pages for %s (%s), using /dev/shm\n",
+                        region->path, strerror(errno));
+                region->hugetlbfs = false;
+            }
+        }
+
+        if (!region->hugetlbfs) {
+            snprintf(region->path, sizeof(region->path), "/bakery-%s-%s", shm_options.run_id, name);
+            if (create_posix_region(region) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    memset(region->addr, 0, region->size);
+    region->in_use = true;
+    *addr = region->addr;
+    return handle;
+}
+
+// Address of a region in the calling process. Every process is forked from the
+// creator after the region exists and inherits its mapping, so this hands that
+// mapping out instead of mapping the region a second time
+void *shm_region_attach(int handle) {
+    if (handle < 0 || handle >= SHM_REGION_MAX || !regions[handle].in_use) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ShmRegion *region = &regions[handle];
+
+#ifdef MADV_POPULATE_WRITE
+    // fork does not copy page tables of shared mappings; fill them in again
+    if (shm_options.prefault) {
+        madvise(region->addr, region->size, MADV_POPULATE_WRITE);
+    }
+#endif
+
+    return region->addr;
+}
+
+// Give up a mapping returned by shm_region_attach. The shared mapping stays
+// until shm_region_destroy or exit, so there is nothing to undo
+void shm_region_detach(int handle, void *addr) {
+    (void) handle;
+    (void) addr;
+}
+
+// Unmap the creator's mapping and remove the region (called by the parent during cleanup)
+void shm_region_destroy(int handle) {
+    if (handle < 0 || handle >= SHM_REGION_MAX || !regions[handle].in_use) {
+        return;
+    }
+
+    ShmRegion *region = &regions[handle];
+
+    if (shm_options.backend == SHM_BACKEND_SYSV) {
+        shmdt(region->addr);
+        shmctl(region->shm_id, IPC_RMID, NULL);
+    } else {
+        munmap(region->addr, region->size);
+        close(region->fd);
+        remove_region_file(region);
+    }
+
+    memset(region, 0, sizeof(ShmRegion));
+}
+
+// True when other IPC objects should be private to this run as well
+bool shm_region_namespaced(void) {
+    return shm_options.backend == SHM_BACKEND_POSIX;
+}
+
+// Parse a backend name from the config file
+ShmBackend parse_shm_backend(const char *name) {
+    if (strncmp(name, "posix", 5) == 0) {
+        return SHM_BACKEND_POSIX;
+    } else if (strncmp(name, "sysv", 4) != 0) {
+        fprintf(stderr, "Unknown shared memory backend '%s', using sysv\n", name);
+    }
+    return SHM_BACKEND_SYSV;
+}
+
+// Human readable backend name for logging
+const char *shm_backend_name(ShmBackend backend) {
+    const char *names[] = {"sysv", "posix"};
+
+    if (backend < 0 || backend >= SHM_BACKEND_COUNT) {
+        return "unknown";
+    }
+    return names[backend];
+}
@@ -0,0 +1,274 @@
+#include "../include/shm_ring.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <stddef.h>
+
+// Polls before a futex waiter goes to sleep (data often shows up within microseconds)
+#define RING_SPINS_BEFORE_SLEEP 64
+
+// Polls before a spinning waiter yields once, in case the other side is descheduled
+#define RING_SPINS_BEFORE_YIELD 1000
+
+// Longest single futex sleep without a deadline; the loop simply sleeps again
+#define RING_MAX_SLEEP_MS 1000
+
+// Header of every slot; the payload follows it
+typedef struct {
+    _Atomic uint64_t sequence;
+} RingSlot;
+
+static RingSlot *slot_at(ShmRing *ring, uint64_t pos) {
+    return (RingSlot *) (ring->slots + (size_t) (pos & ring->mask) * ring->stride);
+}
+
+static void *slot_payload(RingSlot *slot) {
+    return (unsigned char *) slot + sizeof(RingSlot);
+}
+
+// Bytes between slots: sequence plus payload, rounded up so slots do not share cache lines
+static uint32_t slot_stride(uint32_t slot_size) {
+    uint32_t bytes = sizeof(RingSlot) + slot_size;
+    return (bytes + CACHE_LINE_SIZE - 1) & ~(uint32_t) (CACHE_LINE_SIZE - 1);
+}
+
+// Milliseconds left until deadline, rounded up; 0 once it has passed
+static long remaining_ms(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long long ns = (long long) (deadline->tv_sec - now.tv_sec) * 1000000000LL +
+                   (deadline->tv_nsec - now.tv_nsec);
+    return ns <= 0 ? 0 : (long) ((ns + 999999) / 1000000);
+}
+
+// Wait for the other side according to the ring's strategy; -1 with errno on timeout/signal
+static int ring_wait(ShmRing *ring, WakeupChannel *channel, unsigned int seen, int *spins,
+                     const struct timespec *deadline) {
+    long timeout_ms = RING_MAX_SLEEP_MS;
+
+    if (deadline != NULL) {
+        timeout_ms = remaining_ms(deadline);
+        if (timeout_ms == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (timeout_ms > RING_MAX_SLEEP_MS) {
+            timeout_ms = RING_MAX_SLEEP_MS;
+        }
+    }
+
+    switch (ring->wait) {
+        case WAIT_SPIN:
+            if (++(*spins) >= RING_SPINS_BEFORE_YIELD) {
+                sched_yield();
+                *spins = 0;
+            } else {
+                cpu_relax();
+            }
+            return 0;
+
+        case WAIT_YIELD:
+            sched_yield();
+            return 0;
+
+        case WAIT_FUTEX:
+        default:
+            if (++(*spins) < RING_SPINS_BEFORE_SLEEP) {
+                cpu_relax();
+                return 0;
+            }
+            *spins = 0;
+
+            if (wakeup_wait(channel, seen, (int) timeout_ms) == -1 && errno == EINTR) {
+                return -1;
+            }
+            // Woken, timed out (the deadline is checked on the next round) or raced a notify
+            return 0;
+    }
+}
+
+// Shared memory needed for a ring of capacity slots of slot_size bytes
+size_t shm_ring_size(uint32_t capacity, uint32_t slot_size) {
+    return sizeof(ShmRing) + (size_t) capacity * slot_stride(slot_size);
+}
+
+// Initialize a ring in zeroed shared memory (called once by the parent before forking)
+int shm_ring_init(ShmRing *ring, uint32_t capacity, uint32_t slot_size, WaitStrategy wait) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0 || slot_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->slot_size = slot_size;
+    ring->stride = slot_stride(slot_size);
+    ring->wait = wait;
+    atomic_store_explicit(&ring->enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->dequeue_pos, 0, memory_order_relaxed);
+
+    // Slot i is free for the producer that claims position i
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_store_explicit(&slot_at(ring, i)->sequence, i, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    return 0;
+}
+
+// Add an item if there is room; false if the ring is full
+bool shm_ring_try_push(ShmRing *ring, const void *item) {
+    uint64_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    RingSlot *slot;
+
+    while (1) {
+        slot = slot_at(ring, pos);
+        uint64_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t diff = (int64_t) (seq - pos);
+
+        if (diff == 0) {
+            // The slot is free for position pos; claim it
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The consumer of the previous lap has not freed the slot yet
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(slot_payload(slot), item, ring->slot_size);
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// Take the oldest item if there is one; false if the ring is empty
+bool shm_ring_try_pop(ShmRing *ring, void *item) {
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    RingSlot *slot;
+
+    while (1) {
+        slot = slot_at(ring, pos);
+        uint64_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t diff = (int64_t) (seq - (pos + 1));
+
+        if (diff == 0) {
+            // The slot holds the item for position pos; claim it
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Nothing published at this position yet
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(item, slot_payload(slot), ring->slot_size);
+    // Hand the slot to the producer one lap ahead
+    atomic_store_explicit(&slot->sequence, pos + ring->mask + 1, memory_order_release);
+    return true;
+}
+
+// Add an item, waiting for room until the deadline
+int shm_ring_push(ShmRing *ring, const void *item, const struct timespec *deadline) {
+    int spins = 0;
+
+    while (1) {
+        unsigned int seen = wakeup_prepare(&ring->not_full);
+
+        if (shm_ring_try_push(ring, item)) {
+            if (ring->wait == WAIT_FUTEX) {
+                wakeup_notify_one(&ring->not_empty);
+            }
+            return 0;
+        }
+
+        if (ring_wait(ring, &ring->not_full, seen, &spins, deadline) == -1) {
+            return -1;
+        }
+    }
+}
+
+// Take the oldest item, waiting for one until the deadline
+int shm_ring_pop(ShmRing *ring, void *item, const struct timespec *deadline) {
+    int spins = 0;
+
+    while (1) {
+        unsigned int seen = wakeup_prepare(&ring->not_empty);
+
+        if (shm_ring_try_pop(ring, item)) {
+            if (ring->wait == WAIT_FUTEX) {
+                wakeup_notify_one(&ring->not_full);
+            }
+            return 0;
+        }
+
+        if (ring_wait(ring, &ring->not_empty, seen, &spins, deadline) == -1) {
+            return -1;
+        }
+    }
+}
+
+// Take the oldest item of the first non-empty ring (rings are given most urgent first),
+// waiting until the deadline on channel, which producers notify after every push
+int shm_ring_pop_first(ShmRing **rings, int count, WakeupChannel *channel, void *item,
+                       const struct timespec *deadline) {
+    int spins = 0;
+
+    while (1) {
+        unsigned int seen = wakeup_prepare(channel);
+
+        for (int i = 0; i < count; i++) {
+            if (shm_ring_try_pop(rings[i], item)) {
+                if (rings[i]->wait == WAIT_FUTEX) {
+                    wakeup_notify_one(&rings[i]->not_full);
+                }
+                return 0;
+            }
+        }
+
+        if (ring_wait(rings[0], channel, seen, &spins, deadline) == -1) {
+            return -1;
+        }
+    }
+}
+
+// Smallest power of two holding requested slots (at least 2)
+uint32_t shm_ring_round_capacity(int requested) {
+    uint32_t capacity = 2;
+
+    while (capacity < (uint32_t) requested && capacity < (1u << 30)) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Parse a wait strategy name from the config file
+WaitStrategy parse_wait_strategy(const char *name) {
+    if (strncmp(name, "spin", 4) == 0) {
+        return WAIT_SPIN;
+    } else if (strncmp(name, "yield", 5) == 0) {
+        return WAIT_YIELD;
+    } else if (strncmp(name, "futex", 5) != 0) {
+        fprintf(stderr, "Unknown wait strategy '%s', using futex\n", name);
+    }
+    return WAIT_FUTEX;
+}
+
+// Human readable wait strategy name for logging
+const char *wait_strategy_name(WaitStrategy wait) {
+    const char *names[] = {"spin", "yield", "futex"};
+
+    if (wait < 0 || wait >= WAIT_STRATEGY_COUNT) {
+        return "unknown";
+    }
+    return names[wait];
+}
@@ -0,0 +1,50 @@
+#include "../include/snapshot.h"
+#include "../include/stats.h"
+#include <stdatomic.h>
+
+// Copy the production status without taking any lock, retrying if a writer interfered,
+// and merge the per-worker statistics shards
+void read_production_snapshot(ProductionStatus *status, ProductionSnapshot *snapshot) {
+    StatsTotals totals;
+    unsigned int seq;
+
+    do {
+        seq = stats_seq_read_begin(STATS_SEQ_STATUS);
+
+        for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
+            snapshot->produced_items[i] = atomic_load_explicit(&status->produced_items[i],
+                                                               memory_order_relaxed);
+            snapshot->sold_items[i] = atomic_load_explicit(&status->sold_items[i],
+                                                           memory_order_relaxed);
+        }
+    } while (stats_seq_read_retry(STATS_SEQ_STATUS, seq));
+
+    // Shard counters only grow, so the merged totals are never ahead of the workers
+    stats_merge(&totals);
+    snapshot->frustrated_customers = totals.frustrated_customers;
+    snapshot->complained_customers = totals.complained_customers;
+    snapshot->missing_items_requests = totals.missing_items_requests;
+    snapshot->total_profit = totals.total_profit;
+
+    // Written once at startup
+    snapshot->start_time = status->start_time;
+}
+
+// Copy the inventory levels without taking any lock, retrying if a writer interfered
+void read_inventory_snapshot(Inventory *inventory, InventorySnapshot *snapshot) {
+    unsigned int seq;
+
+    do {
+        seq = stats_seq_read_begin(STATS_SEQ_INVENTORY);
+
+        for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+            snapshot->quantities[i] = atomic_load_explicit(&inventory->quantities[i],
+                                                           memory_order_relaxed);
+        }
+    } while (stats_seq_read_retry(STATS_SEQ_INVENTORY, seq));
+
+    // Written once at startup
+    for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+        snapshot->min_thresholds[i] = inventory->min_thresholds[i];
+    }
+}
@@ -0,0 +1,189 @@
+#include "../include/stats.h"
+#include "../include/lockstat.h"
+#include "../include/counters.h"
+#include "../include/shm_region.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+// Attached by the parent before forking, so every worker inherits the mapping
+static StatsTable *stats_table = NULL;
+
+// Shard this process writes to
+static WorkerStats *local_stats = NULL;
+
+// Create and attach the statistics segment with one shard per worker
+int stats_create(BakeryConfig config) {
+    int role_count[ROLE_COUNT] = {0};
+    int num_shards = 0;
+
+    for (int i = 0; i < CHEF_TYPE_COUNT; i++) {
+        role_count[ROLE_CHEF] += config.num_chefs[i];
+    }
+    for (int i = 0; i < BAKER_TYPE_COUNT; i++) {
+        role_count[ROLE_BAKER] += config.num_bakers[i];
+    }
+    role_count[ROLE_SELLER] = config.num_sellers;
+    role_count[ROLE_SUPPLY_CHAIN] = config.num_supply_chain;
+    role_count[ROLE_CUSTOMER] = CUSTOMER_STAT_SHARDS;
+    role_count[ROLE_MANAGEMENT] = 1;
+
+    for (int i = 0; i < ROLE_COUNT; i++) {
+        num_shards += role_count[i];
+    }
+
+    size_t size = sizeof(StatsTable) + num_shards * sizeof(WorkerStats);
+    int shm_id = shm_region_create("stats", IPC_PRIVATE, size, (void **) &stats_table);
+    if (shm_id == -1) {
+        stats_table = NULL;
+        return -1;
+    }
+
+    stats_table->num_shards = num_shards;
+
+    int next = 0;
+    for (int role = 0; role < ROLE_COUNT; role++) {
+        stats_table->role_first[role] = next;
+        stats_table->role_count[role] = role_count[role];
+
+        for (int i = 0; i < role_count[role]; i++) {
+            stats_table->shards[next + i].role = (WorkerRole)role;
+            stats_table->shards[next + i].worker_id = i;
+        }
+        next += role_count[role];
+    }
+
+    return shm_id;
+}
+
+// Select the shard of this process (customers pass their customer id)
+void stats_bind_worker(WorkerRole role, int index) {
+    if (stats_table == NULL || stats_table->role_count[role] == 0) {
+        fprintf(stderr, "Stats: no shard available for role %d\n", role);
+        exit(EXIT_FAILURE);
+    }
+
+    index %= stats_table->role_count[role];
+    local_stats = &stats_table->shards[stats_table->role_first[role] + index];
+    
+    // Lock operations of this process are reported under the same role
+    lockstat_bind_role(role);
+}
+
+// Shard of the calling process
+WorkerStats *stats_local(void) {
+    return local_stats;
+}
+
+// Sum all shards (only readers pay for aggregation)
+void stats_merge(StatsTotals *totals) {
+    memset(totals, 0, sizeof(StatsTotals));
+
+    if (stats_table == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < stats_table->num_shards; i++) {
+        WorkerStats *shard = &stats_table->shards[i];
+
+        totals->items_handled[shard->role] += atomic_load_explicit(&shard->items_handled,
+                                                                   memory_order_relaxed);
+        totals->frustrated_customers += atomic_load_explicit(&shard->frustrated_customers,
+                                                             memory_order_relaxed);
+        totals->complained_customers += atomic_load_explicit(&shard->complained_customers,
+                                                             memory_order_relaxed);
+        totals->missing_items_requests += atomic_load_explicit(&shard->missing_items_requests,
+                                                               memory_order_relaxed);
+        totals->expired_orders += atomic_load_explicit(&shard->expired_orders, memory_order_relaxed);
+        totals->total_profit += atomic_load_explicit(&shard->total_profit, memory_order_relaxed);
+    }
+}
+
+// Print the items handled by each worker of a role (used by the summary)
+void stats_print_workers(WorkerRole role, const char *label) {
+    if (stats_table == NULL) {
+        return;
+    }
+
+    printf("%s:\n", label);
+    for (int i = 0; i < stats_table->role_count[role]; i++) {
+        WorkerStats *shard = &stats_table->shards[stats_table->role_first[role] + i];
+        printf("  %d: %d\n", i, atomic_load_explicit(&shard->items_handled, memory_order_relaxed));
+    }
+}
+
+// Sequence lock of the calling worker for one kind of shared data; workers
+// never share a sequence, so their write sections do not contend
+SeqLock *stats_seqlock(StatsSeqKind kind) {
+    return &local_stats->seqlocks[kind];
+}
+
+// Start a lock-free read of one kind of shared data; returns the sum of every
+// worker's sequence, after waiting out the writers inside a section
+unsigned int stats_seq_read_begin(StatsSeqKind kind) {
+    unsigned int sum = 0;
+
+    if (stats_table == NULL) {
+        return 0;
+    }
+
+    for (int i = 0; i < stats_table->num_shards; i++) {
+        sum += seqlock_read_begin(&stats_table->shards[i].seqlocks[kind]);
+    }
+    return sum;
+}
+
+// Finish the read; true if any worker wrote in the meantime (sequences only grow,
+// so an unchanged sum means unchanged sequences)
+bool stats_seq_read_retry(StatsSeqKind kind, unsigned int start) {
+    unsigned int sum = 0;
+
+    if (stats_table == NULL) {
+        return false;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    for (int i = 0; i < stats_table->num_shards; i++) {
+        sum += atomic_load_explicit(&stats_table->shards[i].seqlocks[kind].sequence,
+                                    memory_order_relaxed);
+    }
+    return sum != start;
+}
+
+// Record one batch of orders served under a single lock hold (sellers only)
+void stats_record_batch(int orders) {
+    counter_add(&local_stats->batches, 1);
+    counter_add(&local_stats->batched_orders, orders);
+    
+    // Only this seller writes its shard
+    if (orders > counter_read(&local_stats->largest_batch)) {
+        atomic_store_explicit(&local_stats->largest_batch, orders, memory_order_relaxed);
+    }
+}
+
+// Print the batch sizes of each seller (used by the summary)
+void stats_print_batches(void) {
+    if (stats_table == NULL) {
+        return;
+    }
+    
+    printf("Seller batches (orders per lock hold):\n");
+    for (int i = 0; i < stats_table->role_count[ROLE_SELLER]; i++) {
+        WorkerStats *shard = &stats_table->shards[stats_table->role_first[ROLE_SELLER] + i];
+        int batches = counter_read(&shard->batches);
+        int orders = counter_read(&shard->batched_orders);
+        
+        printf("  %d: %d batches, %d orders, avg %.2f, largest %d\n", i, batches, orders,
+               batches > 0 ? (double) orders / batches : 0.0, counter_read(&shard->largest_batch));
+    }
+}
+
+// Remove the statistics segment
+void stats_destroy(int stats_shm_id) {
+    if (stats_shm_id != -1) {
+        shm_region_destroy(stats_shm_id);
+    }
+    stats_table = NULL;
+}
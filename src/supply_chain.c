@@ -1,4 +1,6 @@
 #include "../include/supply_chain.h"
+#include "../include/counters.h"
+#include "../include/stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -33,20 +35,18 @@ void initialize_inventory(Inventory *inventory, BakeryConfig config) {
 
 // Supply chain employee process
 void supply_chain_process(int id, int inventory_shm_id, int prod_status_shm_id,
-                        int inventory_sem_id, int management_msgq_id, BakeryConfig config) {
+                        int management_msgq_id, BakeryConfig config) {
     
     // Attach to shared memory segments
-    Inventory *inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    ProductionStatus *status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    Inventory *inventory = (Inventory *) shm_region_attach(inventory_shm_id);
+    ProductionStatus *status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (inventory == (void *) -1 || status == (void *) -1) {
+    if (inventory == NULL || status == NULL) {
         perror("Supply Chain: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
     
-    // Define semaphore operations
-    struct sembuf inventory_lock = {0, -1, 0};   // Lock inventory
-    struct sembuf inventory_unlock = {0, 1, 0};  // Unlock inventory
+    stats_bind_worker(ROLE_SUPPLY_CHAIN, id);
     
     printf("Supply chain employee %d started (PID: %d)\n", id, getpid());
     
@@ -60,21 +60,36 @@ void supply_chain_process(int id, int inventory_shm_id, int prod_status_shm_id,
     while (status->simulation_active) {
         bool reordered = false;
         
-        // Lock inventory to check levels
-        if (semop(inventory_sem_id, &inventory_lock, 1) == -1) {
-            perror("Supply Chain: Failed to lock inventory semaphore");
-            break;
-        }
-        
-        // Check inventory levels and reorder if necessary
+        // Check inventory levels and reorder if necessary, locking one material at a time
+        // so chefs working with other materials are not held up
         for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
+            int order_amount = 0;
+            
+            if (bakery_lock_acquire(&inventory->item_locks[i]) == -1) {
+                perror("Supply Chain: Failed to lock inventory semaphore");
+                break;
+            }
+            
             if (inventory->quantities[i] < inventory->min_thresholds[i]) {
                 // Reorder materials
-                int order_amount = config.min_purchases[i] + 
-                                  rand() % (config.max_purchases[i] - config.min_purchases[i] + 1);
+                order_amount = config.min_purchases[i] + 
+                              rand() % (config.max_purchases[i] - config.min_purchases[i] + 1);
                 
+                seqlock_write_begin(stats_seqlock(STATS_SEQ_INVENTORY));
                 inventory->quantities[i] += order_amount;
+                seqlock_write_end(stats_seqlock(STATS_SEQ_INVENTORY));
+            }
+            
+            if (bakery_lock_release(&inventory->item_locks[i]) == -1) {
+                perror("Supply Chain: Failed to unlock inventory semaphore");
+                break;
+            }
+            
+            if (order_amount > 0) {
+                // Wake the chefs that are waiting for this material
+                wakeup_notify(&inventory->restocked[i]);
                 
+                counter_add(&stats_local()->items_handled, order_amount);
                 printf("Supply chain employee %d ordered %d of item type %d\n", id, order_amount, i);
                 
                 reordered = true;
@@ -84,12 +99,6 @@ void supply_chain_process(int id, int inventory_shm_id, int prod_status_shm_id,
             }
         }
         
-        // Unlock inventory
-        if (semop(inventory_sem_id, &inventory_unlock, 1) == -1) {
-            perror("Supply Chain: Failed to unlock inventory semaphore");
-            break;
-        }
-        
         if (!reordered) {
             // If no reordering was done, sleep for a while before checking again
             sleep(5);
@@ -99,6 +108,6 @@ void supply_chain_process(int id, int inventory_shm_id, int prod_status_shm_id,
     printf("Supply chain employee %d terminating (PID: %d)\n", id, getpid());
     
     // Detach from shared memory
-    shmdt(inventory);
-    shmdt(status);
+    shm_region_detach(inventory_shm_id, inventory);
+    shm_region_detach(prod_status_shm_id, status);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "../include/common.h"
+#include "../include/snapshot.h"
 #include <GL/glut.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +14,10 @@ extern ProductionStatus *prod_status;
 extern Inventory *inventory;
 BakeryConfig config;
 
+// Consistent copies of shared memory taken once per frame
+ProductionSnapshot prod_view;
+InventorySnapshot inventory_view;
+
 // Colors for different elements
 float colors[7][3] = {
     {0.9f, 0.7f, 0.4f},  // Bread (light brown)
@@ -44,11 +49,11 @@ void drawProductionGraph(float x, float y, float width, float height) {
     
     // Find maximum value for scaling
     for (int i = 0; i < PRODUCT_TYPE_COUNT; i++) {
-        if (prod_status->produced_items[i] > max_value) {
-            max_value = prod_status->produced_items[i];
+        if (prod_view.produced_items[i] > max_value) {
+            max_value = prod_view.produced_items[i];
         }
-        if (prod_status->sold_items[i] > max_value) {
-            max_value = prod_status->sold_items[i];
+        if (prod_view.sold_items[i] > max_value) {
+            max_value = prod_view.sold_items[i];
         }
     }
     
@@ -70,8 +75,8 @@ void drawProductionGraph(float x, float y, float width, float height) {
         float sold_height = 0;
         
         if (max_value > 0) {
-            prod_height = (float)prod_status->produced_items[i] / max_value * height;
-            sold_height = (float)prod_status->sold_items[i] / max_value * height;
+            prod_height = (float)prod_view.produced_items[i] / max_value * height;
+            sold_height = (float)prod_view.sold_items[i] / max_value * height;
         }
         
         // Draw produced items bar
@@ -100,7 +105,7 @@ void drawProductionGraph(float x, float y, float width, float height) {
         glColor3f(1.0f, 1.0f, 1.0f);
         renderText(x + i * bar_width + 5, y + 15, label);
         
-        sprintf(label, "%d/%d", prod_status->produced_items[i], prod_status->sold_items[i]);
+        sprintf(label, "%d/%d", prod_view.produced_items[i], prod_view.sold_items[i]);
         renderText(x + i * bar_width + 5, y + 5, label);
     }
     
@@ -117,8 +122,8 @@ void drawInventoryLevels(float x, float y, float width, float height) {
     
     // Find maximum value for scaling
     for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
-        if (inventory->quantities[i] > max_value) {
-            max_value = inventory->quantities[i];
+        if (inventory_view.quantities[i] > max_value) {
+            max_value = inventory_view.quantities[i];
         }
     }
     
@@ -127,11 +132,11 @@ void drawInventoryLevels(float x, float y, float width, float height) {
     
     // Draw bars
     for (int i = 0; i < ITEM_RAW_MATERIAL_COUNT; i++) {
-        float level_height = (float)inventory->quantities[i] / max_value * height;
-        float threshold_height = (float)inventory->min_thresholds[i] / max_value * height;
+        float level_height = (float)inventory_view.quantities[i] / max_value * height;
+        float threshold_height = (float)inventory_view.min_thresholds[i] / max_value * height;
         
         // Choose color based on inventory level
-        if (inventory->quantities[i] <= inventory->min_thresholds[i]) {
+        if (inventory_view.quantities[i] <= inventory_view.min_thresholds[i]) {
             glColor3f(0.8f, 0.0f, 0.0f);  // Red for low stock
         } else {
             glColor3f(0.0f, 0.7f, 0.0f);  // Green for good stock
@@ -160,7 +165,7 @@ void drawInventoryLevels(float x, float y, float width, float height) {
         glColor3f(1.0f, 1.0f, 1.0f);
         renderText(x + i * bar_width + 2, y + 15, label);
         
-        sprintf(label, "%d", inventory->quantities[i]);
+        sprintf(label, "%d", inventory_view.quantities[i]);
         renderText(x + i * bar_width + 5, y + 5, label);
     }
 }
@@ -173,23 +178,23 @@ void drawStatusInfo(float x, float y) {
     sprintf(buffer, "Bakery Simulation Status");
     renderText(x, y, buffer);
     
-    sprintf(buffer, "Current profit: $%.2f", prod_status->total_profit);
+    sprintf(buffer, "Current profit: $%.2f", prod_view.total_profit);
     renderText(x, y - 20, buffer);
     
     sprintf(buffer, "Frustrated customers: %d/%d", 
-            prod_status->frustrated_customers, config.thresholds[0]);
+            prod_view.frustrated_customers, config.thresholds[0]);
     renderText(x, y - 40, buffer);
     
     sprintf(buffer, "Complained customers: %d/%d", 
-            prod_status->complained_customers, config.thresholds[1]);
+            prod_view.complained_customers, config.thresholds[1]);
     renderText(x, y - 60, buffer);
     
     sprintf(buffer, "Missing items requests: %d/%d", 
-            prod_status->missing_items_requests, config.thresholds[2]);
+            prod_view.missing_items_requests, config.thresholds[2]);
     renderText(x, y - 80, buffer);
     
     time_t current_time = time(NULL);
-    int elapsed_minutes = (int)((current_time - prod_status->start_time) / 60);
+    int elapsed_minutes = (int)((current_time - prod_view.start_time) / 60);
     sprintf(buffer, "Elapsed time: %d/%d minutes", 
             elapsed_minutes, config.max_simulation_time);
     renderText(x, y - 100, buffer);
@@ -197,6 +202,10 @@ void drawStatusInfo(float x, float y) {
 
 // Display callback function
 void display() {
+    // Copy shared memory without locking so every frame shows one consistent state
+    read_production_snapshot(prod_status, &prod_view);
+    read_inventory_snapshot(inventory, &inventory_view);
+    
     // Clear the screen
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -252,10 +261,10 @@ void init_opengl(int argc, char *argv[]) {
 void setup_opengl(int argc, char *argv[], int inventory_shm_id, int prod_status_shm_id,
                 BakeryConfig bakery_config) {
     // Attach to shared memory segments
-    inventory = (Inventory *) shmat(inventory_shm_id, NULL, 0);
-    prod_status = (ProductionStatus *) shmat(prod_status_shm_id, NULL, 0);
+    inventory = (Inventory *) shm_region_attach(inventory_shm_id);
+    prod_status = (ProductionStatus *) shm_region_attach(prod_status_shm_id);
     
-    if (inventory == (void *) -1 || prod_status == (void *) -1) {
+    if (inventory == NULL || prod_status == NULL) {
         perror("Visualization: Failed to attach to shared memory");
         return;
     }
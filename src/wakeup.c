@@ -0,0 +1,61 @@
+#include "../include/wakeup.h"
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// The channels are shared between processes, so the FUTEX_PRIVATE_FLAG variants cannot be used
+static long futex(_Atomic unsigned int *word, int op, unsigned int value,
+                  const struct timespec *timeout) {
+    return syscall(SYS_futex, (unsigned int *) word, op, value, timeout, NULL, 0);
+}
+
+// Read the generation to pass to wakeup_wait()
+unsigned int wakeup_prepare(WakeupChannel *channel) {
+    return atomic_load_explicit(&channel->generation, memory_order_acquire);
+}
+
+// Block until the generation moves past seen or timeout_ms elapses.
+// Returns 0 when woken (or the generation had already moved) and -1 with
+// errno set to ETIMEDOUT or EINTR otherwise
+int wakeup_wait(WakeupChannel *channel, unsigned int seen, int timeout_ms) {
+    struct timespec timeout;
+    long rc;
+
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+    // Announce ourselves before the final check of the word so a notifier
+    // that bumps the generation after it also sees us and issues the wake
+    atomic_fetch_add_explicit(&channel->waiters, 1, memory_order_seq_cst);
+    rc = futex(&channel->generation, FUTEX_WAIT, seen, &timeout);
+    atomic_fetch_sub_explicit(&channel->waiters, 1, memory_order_relaxed);
+
+    if (rc == -1 && errno == EAGAIN) {
+        // The generation changed before we slept
+        return 0;
+    }
+
+    return rc == 0 ? 0 : -1;
+}
+
+// Bump the generation and wake up to count waiters
+static void notify(WakeupChannel *channel, int count) {
+    atomic_fetch_add_explicit(&channel->generation, 1, memory_order_seq_cst);
+
+    if (atomic_load_explicit(&channel->waiters, memory_order_seq_cst) > 0) {
+        futex(&channel->generation, FUTEX_WAKE, count, NULL);
+    }
+}
+
+// Wake every process waiting on the channel
+void wakeup_notify(WakeupChannel *channel) {
+    notify(channel, INT_MAX);
+}
+
+// Wake a single waiter (for hand-offs where only one process can make progress)
+void wakeup_notify_one(WakeupChannel *channel) {
+    notify(channel, 1);
+}
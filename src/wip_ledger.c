@@ -0,0 +1,63 @@
+#include "../include/wip_ledger.h"
+#include <stdatomic.h>
+#include "../include/wakeup.h"
+
+// Add freshly produced items to the ledger and wake consumers waiting for them
+void wip_deposit(WipLedger *ledger, WipItem item, int quantity) {
+    atomic_fetch_add_explicit(&ledger->entries[item].available, quantity, memory_order_release);
+    wakeup_notify(&ledger->entries[item].ready);
+}
+
+// Claim quantity items if that many are available, all or nothing
+bool wip_reserve(WipLedger *ledger, WipItem item, int quantity) {
+    WipEntry *entry = &ledger->entries[item];
+    int available = atomic_load_explicit(&entry->available, memory_order_acquire);
+
+    while (available >= quantity) {
+        if (atomic_compare_exchange_weak_explicit(&entry->available, &available,
+                                                  available - quantity,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&entry->reserved, quantity, memory_order_relaxed);
+            return true;
+        }
+        // available was reloaded by the failed exchange, try again
+    }
+
+    return false;
+}
+
+// Turn a reservation into consumption
+void wip_commit(WipLedger *ledger, WipItem item, int quantity) {
+    WipEntry *entry = &ledger->entries[item];
+
+    atomic_fetch_sub_explicit(&entry->reserved, quantity, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->consumed, quantity, memory_order_relaxed);
+}
+
+// Give reserved items back (the consumer could not use them)
+void wip_abort(WipLedger *ledger, WipItem item, int quantity) {
+    WipEntry *entry = &ledger->entries[item];
+
+    atomic_fetch_sub_explicit(&entry->reserved, quantity, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->available, quantity, memory_order_release);
+    wakeup_notify(&entry->ready);
+}
+
+// Items that can currently be reserved
+int wip_available(WipLedger *ledger, WipItem item) {
+    return atomic_load_explicit(&ledger->entries[item].available, memory_order_acquire);
+}
+
+// Map a product to its ledger entry; false for products the ledger does not track
+bool wip_item_for_product(ProductType product_type, WipItem *item) {
+    switch (product_type) {
+        case PRODUCT_PASTE:
+            *item = WIP_PASTE;
+            return true;
+        case PRODUCT_BREAD:
+            *item = WIP_BREAD;
+            return true;
+        default:
+            return false;
+    }
+}